@@ -0,0 +1,550 @@
+/*
+ * File:   bench_scpi.c
+ *
+ * Parser benchmark. Replays command mixes through SCPI_Input, in 64 byte
+ * chunks as they arrive from a USB full speed bulk endpoint, and reports
+ * commands per second and the cost of each stage of handling a command:
+ *
+ *   match  - finding the command header in the table (replayed separately
+ *            over the headers the parser actually looked up)
+ *   param  - SCPI_Param* calls made by the callbacks
+ *   result - SCPI_Result* calls made by the callbacks, including the write
+ *            into the output buffer
+ *   other  - everything else: buffering, line splitting, compound command
+ *            handling and dispatch
+ *
+ * Each mix is run once with the compiled command index and once with the
+ * linear search through the table.
+ *
+ * Usage: bench_scpi.bench [repetitions]
+ */
+
+#define _POSIX_C_SOURCE 199309L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "scpi/scpi.h"
+#include "scpi/utils_private.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+
+#define CYCLE_UNIT "TSC cycles"
+
+static inline uint64_t cycles(void) {
+    return __rdtsc();
+}
+#else
+#define CYCLE_UNIT "ns"
+
+static inline uint64_t cycles(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (uint64_t) t.tv_sec * 1000000000u + t.tv_nsec;
+}
+#endif
+
+#define CHUNK_LENGTH 64
+#define STREAM_LINES 1000
+#define HEADERS_MAX 4096
+#define HEADER_LENGTH 64
+
+/* stage accounting, only while G_TIMED is set */
+static scpi_bool_t G_TIMED = FALSE;
+static uint64_t G_PARAM_CYCLES;
+static uint64_t G_RESULT_CYCLES;
+static uint64_t G_TIMER_OVERHEAD;
+
+#define TIMED(counter, expr) do {                               \
+    if (G_TIMED) {                                              \
+        uint64_t t0_ = cycles();                                \
+        expr;                                                   \
+        counter += cycles() - t0_ - G_TIMER_OVERHEAD;           \
+    } else {                                                    \
+        expr;                                                   \
+    }                                                           \
+} while (0)
+
+/* command headers as looked up by the parser, recorded on the first pass */
+static scpi_bool_t G_RECORDING = FALSE;
+static char G_HEADERS[HEADERS_MAX][HEADER_LENGTH];
+static size_t G_HEADER_LENGTHS[HEADERS_MAX];
+static size_t G_HEADER_COUNT;
+static size_t G_COMMANDS;
+
+static void enter(scpi_t * context) {
+    const scpi_const_buffer_t * raw = &context->paramlist.cmd_raw;
+
+    G_COMMANDS++;
+    if (G_RECORDING && G_HEADER_COUNT < HEADERS_MAX && raw->length < HEADER_LENGTH) {
+        memcpy(G_HEADERS[G_HEADER_COUNT], raw->data, raw->length);
+        G_HEADER_LENGTHS[G_HEADER_COUNT] = raw->length;
+        G_HEADER_COUNT++;
+    }
+}
+
+static volatile double G_SINK;
+
+/*
+ * Callbacks
+ */
+
+/* value with an optional resolution, as CONFigure takes */
+static scpi_result_t Bench_Number(scpi_t * context) {
+    scpi_number_t value, resolution;
+    scpi_bool_t found;
+
+    enter(context);
+    TIMED(G_PARAM_CYCLES, found = SCPI_ParamNumber(context, &value, TRUE)
+            && SCPI_ParamNumber(context, &resolution, FALSE));
+    G_SINK = value.value;
+    return found ? SCPI_RES_OK : SCPI_RES_ERR;
+}
+
+static scpi_result_t Bench_Bool(scpi_t * context) {
+    scpi_bool_t value;
+    scpi_bool_t found;
+
+    enter(context);
+    TIMED(G_PARAM_CYCLES, found = SCPI_ParamBool(context, &value, TRUE));
+    G_SINK = value;
+    return found ? SCPI_RES_OK : SCPI_RES_ERR;
+}
+
+static const char * TRIGGER_SOURCES[] = {"BUS", "IMMediate", "EXTernal", NULL};
+
+static scpi_result_t Bench_Choice(scpi_t * context) {
+    int32_t value;
+    scpi_bool_t found;
+
+    enter(context);
+    TIMED(G_PARAM_CYCLES, found = SCPI_ParamChoice(context, TRIGGER_SOURCES, &value, TRUE));
+    G_SINK = value;
+    return found ? SCPI_RES_OK : SCPI_RES_ERR;
+}
+
+static scpi_result_t Bench_NumberQ(scpi_t * context) {
+    scpi_number_t range, resolution;
+    scpi_bool_t found;
+
+    enter(context);
+    TIMED(G_PARAM_CYCLES, found = SCPI_ParamNumber(context, &range, FALSE)
+            && SCPI_ParamNumber(context, &resolution, FALSE));
+    TIMED(G_RESULT_CYCLES, SCPI_ResultDouble(context, 1.2345678e3));
+    return found ? SCPI_RES_OK : SCPI_RES_ERR;
+}
+
+static scpi_result_t Bench_FetchQ(scpi_t * context) {
+    int i;
+
+    enter(context);
+    for (i = 0; i < 8; i++) {
+        TIMED(G_RESULT_CYCLES, SCPI_ResultDouble(context, -0.125 + i * 3.0517578e-5));
+    }
+    return SCPI_RES_OK;
+}
+
+static scpi_result_t Bench_Plain(scpi_t * context) {
+    enter(context);
+    return SCPI_RES_OK;
+}
+
+/* library queries whose whole work is formatting their result */
+#define BENCH_RESULT(name, callback)                            \
+static scpi_result_t name(scpi_t * context) {                   \
+    scpi_result_t res;                                          \
+    enter(context);                                             \
+    TIMED(G_RESULT_CYCLES, res = callback(context));            \
+    return res;                                                 \
+}
+
+BENCH_RESULT(Bench_IdnQ, SCPI_CoreIdnQ)
+BENCH_RESULT(Bench_OpcQ, SCPI_CoreOpcQ)
+BENCH_RESULT(Bench_ErrorQ, SCPI_SystemErrorNextQ)
+BENCH_RESULT(Bench_ErrorCountQ, SCPI_SystemErrorCountQ)
+
+static scpi_result_t Bench_Cls(scpi_t * context) {
+    enter(context);
+    return SCPI_CoreCls(context);
+}
+
+/*
+ * Command table of a signal source and meter, about the size of a small
+ * instrument's
+ */
+static const scpi_command_t scpi_commands[] = {
+    { .pattern = "*CLS", .callback = Bench_Cls,},
+    { .pattern = "*ESE", .callback = SCPI_CoreEse,},
+    { .pattern = "*ESE?", .callback = SCPI_CoreEseQ,},
+    { .pattern = "*ESR?", .callback = SCPI_CoreEsrQ,},
+    { .pattern = "*IDN?", .callback = Bench_IdnQ,},
+    { .pattern = "*OPC", .callback = SCPI_CoreOpc,},
+    { .pattern = "*OPC?", .callback = Bench_OpcQ,},
+    { .pattern = "*RST", .callback = SCPI_CoreRst,},
+    { .pattern = "*SRE", .callback = SCPI_CoreSre,},
+    { .pattern = "*SRE?", .callback = SCPI_CoreSreQ,},
+    { .pattern = "*STB?", .callback = SCPI_CoreStbQ,},
+    { .pattern = "*TST?", .callback = SCPI_CoreTstQ,},
+    { .pattern = "*WAI", .callback = SCPI_CoreWai,},
+
+    {.pattern = "SYSTem:ERRor[:NEXT]?", .callback = Bench_ErrorQ,},
+    {.pattern = "SYSTem:ERRor:COUNt?", .callback = Bench_ErrorCountQ,},
+    {.pattern = "SYSTem:VERSion?", .callback = SCPI_SystemVersionQ,},
+
+    {.pattern = "STATus:QUEStionable[:EVENt]?", .callback = SCPI_StatusQuestionableEventQ,},
+    {.pattern = "STATus:QUEStionable:ENABle", .callback = SCPI_StatusQuestionableEnable,},
+    {.pattern = "STATus:QUEStionable:ENABle?", .callback = SCPI_StatusQuestionableEnableQ,},
+    {.pattern = "STATus:PRESet", .callback = SCPI_StatusPreset,},
+
+    {.pattern = "[SOURce]:FREQuency[:CW]", .callback = Bench_Number,},
+    {.pattern = "[SOURce]:FREQuency[:CW]?", .callback = Bench_NumberQ,},
+    {.pattern = "[SOURce]:VOLTage[:LEVel][:IMMediate][:AMPLitude]", .callback = Bench_Number,},
+    {.pattern = "[SOURce]:VOLTage[:LEVel][:IMMediate][:AMPLitude]?", .callback = Bench_NumberQ,},
+    {.pattern = "[SOURce]:VOLTage[:LEVel][:IMMediate]:OFFSet", .callback = Bench_Number,},
+    {.pattern = "[SOURce]:VOLTage[:LEVel][:IMMediate]:OFFSet?", .callback = Bench_NumberQ,},
+    {.pattern = "[SOURce]:PHASe[:ADJust]", .callback = Bench_Number,},
+    {.pattern = "[SOURce]:PHASe[:ADJust]?", .callback = Bench_NumberQ,},
+    {.pattern = "OUTPut[:STATe]", .callback = Bench_Bool,},
+    {.pattern = "OUTPut[:STATe]?", .callback = Bench_NumberQ,},
+
+    {.pattern = "CONFigure:VOLTage:DC", .callback = Bench_Number,},
+    {.pattern = "CONFigure:VOLTage:AC", .callback = Bench_Number,},
+    {.pattern = "CONFigure:FREQuency", .callback = Bench_Number,},
+    {.pattern = "MEASure:VOLTage:DC?", .callback = Bench_NumberQ,},
+    {.pattern = "MEASure:VOLTage:AC?", .callback = Bench_NumberQ,},
+    {.pattern = "MEASure:FREQuency?", .callback = Bench_NumberQ,},
+    {.pattern = "[SENSe]:VOLTage:DC:RANGe[:UPPer]", .callback = Bench_Number,},
+    {.pattern = "[SENSe]:VOLTage:DC:RANGe[:UPPer]?", .callback = Bench_NumberQ,},
+    {.pattern = "[SENSe]:VOLTage:DC:NPLCycles", .callback = Bench_Number,},
+    {.pattern = "[SENSe]:VOLTage:DC:NPLCycles?", .callback = Bench_NumberQ,},
+
+    {.pattern = "TRIGger:SOURce", .callback = Bench_Choice,},
+    {.pattern = "TRIGger:DELay", .callback = Bench_Number,},
+    {.pattern = "TRIGger:COUNt", .callback = Bench_Number,},
+    {.pattern = "SAMPle:COUNt", .callback = Bench_Number,},
+    {.pattern = "INITiate[:IMMediate]", .callback = Bench_Plain,},
+    {.pattern = "FETCh?", .callback = Bench_FetchQ,},
+    {.pattern = "READ?", .callback = Bench_FetchQ,},
+
+    SCPI_CMD_LIST_END
+};
+
+/*
+ * Command mixes, one command line per string
+ */
+struct mix {
+    const char * name;
+    const char * lines[16];
+};
+
+static const struct mix MIXES[] = {
+    {"short", {
+        "*CLS\r\n",
+        "CONF:VOLT:DC 10\r\n",
+        "TRIG:SOUR BUS\r\n",
+        "SAMP:COUN 16\r\n",
+        "INIT\r\n",
+        "FREQ 1000\r\n",
+        "VOLT 0.5\r\n",
+        "OUTP ON\r\n",
+        "MEAS:VOLT:DC?\r\n",
+        "SYST:ERR?\r\n",
+        NULL,
+    }},
+    {"long", {
+        "*CLS\r\n",
+        "CONFigure:VOLTage:DC 10\r\n",
+        "TRIGger:SOURce BUS\r\n",
+        "SAMPle:COUNt 16\r\n",
+        "INITiate:IMMediate\r\n",
+        "SOURce:FREQuency:CW 1000\r\n",
+        "SOURce:VOLTage:LEVel:IMMediate:AMPLitude 0.5\r\n",
+        "OUTPut:STATe ON\r\n",
+        "MEASure:VOLTage:DC?\r\n",
+        "SYSTem:ERRor:NEXT?\r\n",
+        NULL,
+    }},
+    {"compound", {
+        "*CLS;:CONF:VOLT:DC 10;:TRIG:SOUR BUS;:SAMP:COUN 16\r\n",
+        "SOUR:FREQ 1000;VOLT 0.5;PHAS 90\r\n",
+        "SOUR:VOLT:OFFS 0.1;:OUTP ON;:INIT;*OPC?\r\n",
+        "SENS:VOLT:DC:RANG 10;NPLC 1;:MEAS:VOLT:DC?\r\n",
+        NULL,
+    }},
+    {"units", {
+        "FREQ 1.5 kHz\r\n",
+        "VOLT 250 mV\r\n",
+        "VOLT:OFFS -1.2 V\r\n",
+        "SOUR:FREQ 10.7 MHz\r\n",
+        "SENS:VOLT:DC:RANG 20 V\r\n",
+        "TRIG:DEL 2.5 ms\r\n",
+        "CONF:FREQ 100 kHz, 1 Hz\r\n",
+        "CONF:VOLT:AC 1 V, 10 mV\r\n",
+        NULL,
+    }},
+    {"queries", {
+        "*IDN?\r\n",
+        "FREQ?\r\n",
+        "SOUR:VOLT:LEV:IMM:AMPL?\r\n",
+        "MEAS:VOLT:DC? 10 V, 1 mV\r\n",
+        "FETC?\r\n",
+        "READ?\r\n",
+        "SYST:ERR:COUN?\r\n",
+        "*OPC?\r\n",
+        NULL,
+    }},
+};
+
+/*
+ * SCPI interface
+ */
+
+static char output_buffer[4096];
+static size_t output_buffer_pos;
+static size_t G_ERRORS;
+
+static size_t SCPI_Write(scpi_t * context, const char * data, size_t len) {
+    (void) context;
+
+    if (output_buffer_pos + len > sizeof (output_buffer)) {
+        output_buffer_pos = 0;
+    }
+    memcpy(output_buffer + output_buffer_pos, data, len);
+    output_buffer_pos += len;
+    return len;
+}
+
+static scpi_result_t SCPI_Flush(scpi_t * context) {
+    (void) context;
+
+    output_buffer_pos = 0;
+    return SCPI_RES_OK;
+}
+
+static int SCPI_Error(scpi_t * context, int_fast16_t err) {
+    (void) context;
+
+    if (G_ERRORS++ == 0) {
+        fprintf(stderr, "**ERROR: %d, \"%s\"\n", (int) err, SCPI_ErrorTranslate(err));
+    }
+    return 0;
+}
+
+static scpi_interface_t scpi_interface = {
+    .error = SCPI_Error,
+    .write = SCPI_Write,
+    .control = NULL,
+    .flush = SCPI_Flush,
+    .reset = NULL,
+    .test = NULL,
+};
+
+#define SCPI_INPUT_BUFFER_LENGTH 256
+static char scpi_input_buffer[SCPI_INPUT_BUFFER_LENGTH];
+
+static scpi_reg_val_t scpi_regs[SCPI_REG_COUNT];
+
+#define SCPI_INDEX_LENGTH 256
+static scpi_command_node_t scpi_index_nodes[SCPI_INDEX_LENGTH];
+
+static scpi_t scpi_context = {
+    .cmdlist = scpi_commands,
+    .buffer = {
+        .length = SCPI_INPUT_BUFFER_LENGTH,
+        .data = scpi_input_buffer,
+    },
+    .interface = &scpi_interface,
+    .registers = scpi_regs,
+    .units = scpi_units_def,
+    .special_numbers = scpi_special_numbers_def,
+    .idn = {"BENCH", "SCPI", NULL, "0"},
+    .cmdindex = {
+        .nodes = scpi_index_nodes,
+        .length = SCPI_INDEX_LENGTH,
+    },
+};
+
+/*
+ * Benchmark
+ */
+
+static char G_STREAM[STREAM_LINES * 64];
+static size_t G_STREAM_LENGTH;
+
+/**
+ * Repeat the lines of a mix to a stream of STREAM_LINES lines
+ */
+static void build_stream(const struct mix * mix) {
+    size_t i, line = 0;
+
+    G_STREAM_LENGTH = 0;
+    for (i = 0; i < STREAM_LINES; i++) {
+        size_t len;
+        if (mix->lines[line] == NULL) {
+            line = 0;
+        }
+        len = strlen(mix->lines[line]);
+        memcpy(G_STREAM + G_STREAM_LENGTH, mix->lines[line], len);
+        G_STREAM_LENGTH += len;
+        line++;
+    }
+}
+
+/**
+ * Feed the stream through the parser in CHUNK_LENGTH pieces
+ * @return cycles taken
+ */
+static uint64_t replay(void) {
+    size_t pos;
+    uint64_t t0 = cycles();
+
+    for (pos = 0; pos < G_STREAM_LENGTH; pos += CHUNK_LENGTH) {
+        size_t len = G_STREAM_LENGTH - pos;
+        if (len > CHUNK_LENGTH) {
+            len = CHUNK_LENGTH;
+        }
+        SCPI_Input(&scpi_context, G_STREAM + pos, len);
+    }
+    return cycles() - t0;
+}
+
+/**
+ * Look up every recorded header
+ * @return cycles taken
+ */
+static uint64_t replay_match(scpi_bool_t indexed) {
+    size_t h;
+    int32_t i;
+    uint64_t t0 = cycles();
+
+    for (h = 0; h < G_HEADER_COUNT; h++) {
+        if (indexed) {
+            i = findIndexedCommand(&scpi_context.cmdindex, G_HEADERS[h], G_HEADER_LENGTHS[h]);
+        } else {
+            for (i = 0; scpi_commands[i].pattern != NULL; i++) {
+                if (matchCommand(scpi_commands[i].pattern, G_HEADERS[h], G_HEADER_LENGTHS[h])) {
+                    break;
+                }
+            }
+        }
+        G_SINK = i;
+    }
+    return cycles() - t0;
+}
+
+static double seconds(const struct timespec * t) {
+    return t->tv_sec + t->tv_nsec * 1e-9;
+}
+
+static void calibrate(void) {
+    int i;
+    uint64_t best = (uint64_t) -1;
+
+    for (i = 0; i < 1000; i++) {
+        uint64_t t0 = cycles();
+        uint64_t t1 = cycles();
+        if (t1 - t0 < best) {
+            best = t1 - t0;
+        }
+    }
+    G_TIMER_OVERHEAD = best;
+}
+
+static void run(const struct mix * mix, scpi_bool_t indexed, unsigned reps, const scpi_command_index_t * index) {
+    struct timespec t0, t1;
+    uint64_t total = 0, match = 0;
+    unsigned r;
+    double n, per_cmd;
+
+    scpi_context.cmdindex = *index;
+    if (!indexed) {
+        scpi_context.cmdindex.count = 0;
+    }
+
+    build_stream(mix);
+
+    /* record the headers looked up, and check the mix parses cleanly */
+    G_RECORDING = TRUE;
+    G_HEADER_COUNT = 0;
+    G_COMMANDS = 0;
+    G_ERRORS = 0;
+    replay();
+    G_RECORDING = FALSE;
+    if (G_ERRORS) {
+        fprintf(stderr, "%s: %u errors\n", mix->name, (unsigned) G_ERRORS);
+        exit(1);
+    }
+    if (G_HEADER_COUNT != G_COMMANDS) {
+        fprintf(stderr, "%s: recorded %u of %u headers\n", mix->name,
+                (unsigned) G_HEADER_COUNT, (unsigned) G_COMMANDS);
+        exit(1);
+    }
+
+    /* throughput, without stage accounting */
+    G_COMMANDS = 0;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    for (r = 0; r < reps; r++) {
+        replay();
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    n = G_COMMANDS;
+
+    /* stages */
+    G_TIMED = TRUE;
+    G_PARAM_CYCLES = 0;
+    G_RESULT_CYCLES = 0;
+    for (r = 0; r < reps; r++) {
+        total += replay();
+        match += replay_match(indexed);
+    }
+    G_TIMED = FALSE;
+
+    per_cmd = (double) total / n;
+    printf("%-9s %-7s %8.0f %10.0f %8.1f %8.1f %8.1f %8.1f %8.1f\n",
+            mix->name, indexed ? "index" : "linear",
+            n / reps,
+            n / (seconds(&t1) - seconds(&t0)),
+            per_cmd,
+            match / n,
+            G_PARAM_CYCLES / n,
+            G_RESULT_CYCLES / n,
+            per_cmd - (double) (match + G_PARAM_CYCLES + G_RESULT_CYCLES) / n);
+}
+
+int main(int argc, char ** argv) {
+    unsigned reps = 200;
+    scpi_command_index_t index;
+    size_t m;
+
+    if (argc > 1) {
+        reps = strtoul(argv[1], NULL, 0);
+    }
+    if (!reps) {
+        fprintf(stderr, "usage: %s [repetitions]\n", argv[0]);
+        return 2;
+    }
+
+    SCPI_Init(&scpi_context);
+    if (scpi_context.cmdindex.count == 0) {
+        fprintf(stderr, "command index does not fit in %d nodes\n", SCPI_INDEX_LENGTH);
+        return 1;
+    }
+    index = scpi_context.cmdindex;
+    calibrate();
+
+    printf("%u lines per stream in %d byte chunks, %u repetitions, %u index nodes\n",
+            STREAM_LINES, CHUNK_LENGTH, reps, (unsigned) index.count);
+    printf("stages in %s per command\n\n", CYCLE_UNIT);
+    printf("%-9s %-7s %8s %10s %8s %8s %8s %8s %8s\n", "mix", "lookup",
+            "cmds", "cmd/s", "total", "match", "param", "result", "other");
+
+    for (m = 0; m < sizeof (MIXES) / sizeof (MIXES[0]); m++) {
+        run(&MIXES[m], TRUE, reps, &index);
+        run(&MIXES[m], FALSE, reps, &index);
+    }
+
+    return 0;
+}
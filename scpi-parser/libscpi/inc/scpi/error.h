@@ -61,6 +61,7 @@ extern "C" {
     X(SCPI_ERROR_SUFFIX_NOT_ALLOWED,   -138, "Suffix not allowed")             \
     X(SCPI_ERROR_EXECUTION_ERROR,      -200, "Execution error")                \
     X(SCPI_ERROR_ILLEGAL_PARAMETER_VALUE,-224,"Illegal parameter value")       \
+    X(SCPI_ERROR_INPUT_BUFFER_OVERRUN, -363, "Input buffer overrun")           \
 
 
 enum {
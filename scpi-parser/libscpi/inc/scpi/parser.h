@@ -53,6 +53,7 @@ extern "C" {
 
     size_t SCPI_ResultString(scpi_t * context, const char * data);
     size_t SCPI_ResultInt(scpi_t * context, int32_t val);
+    size_t SCPI_ResultUInt32Base(scpi_t * context, uint32_t val, int8_t base);
     size_t SCPI_ResultDouble(scpi_t * context, double val);
     size_t SCPI_ResultText(scpi_t * context, const char * data);
     size_t SCPI_ResultBool(scpi_t * context, scpi_bool_t val);
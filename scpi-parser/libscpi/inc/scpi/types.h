@@ -109,6 +109,9 @@ extern "C" {
         size_t length;
         size_t position;
         char * data;
+        size_t start;       /* first byte not yet parsed */
+        size_t scanned;     /* end of bytes searched for a line terminator */
+        scpi_bool_t discard; /* dropping the rest of an overlong line */
     };
     typedef struct _scpi_buffer_t scpi_buffer_t;
     
@@ -195,6 +198,28 @@ extern "C" {
         scpi_command_callback_t callback;
     };
 
+    /* compiled command index */
+    #define SCPI_INDEX_NONE         0xFFFF
+
+    struct _scpi_command_node_t {
+        const char * keyword;
+        uint8_t length;
+        uint8_t short_length;
+        scpi_bool_t numeric;
+        uint16_t child;
+        uint16_t sibling;
+        uint16_t command;
+        uint16_t query;
+    };
+    typedef struct _scpi_command_node_t scpi_command_node_t;
+
+    struct _scpi_command_index_t {
+        scpi_command_node_t * nodes;
+        size_t length;
+        size_t count;
+    };
+    typedef struct _scpi_command_index_t scpi_command_index_t;
+
     struct _scpi_interface_t {
         scpi_error_callback_t error;
         scpi_write_t write;
@@ -218,6 +243,7 @@ extern "C" {
         const scpi_special_number_def_t * special_numbers;
         void * user_context;
         const char * idn[4];
+        scpi_command_index_t cmdindex;
     };
 
 #ifdef  __cplusplus
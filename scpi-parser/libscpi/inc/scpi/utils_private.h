@@ -55,6 +55,7 @@ extern "C" {
     scpi_bool_t compareStr(const char * str1, size_t len1, const char * str2, size_t len2) LOCAL;
     scpi_bool_t compareStrAndNum(const char * str1, size_t len1, const char * str2, size_t len2) LOCAL;
     size_t longToStr(int32_t val, char * str, size_t len) LOCAL;
+    size_t uint32ToStrBase(uint32_t val, char * str, size_t len, int8_t base) LOCAL;
     size_t doubleToStr(double val, char * str, size_t len) LOCAL;
     size_t strToLong(const char * str, int32_t * val) LOCAL;
     size_t strToDouble(const char * str, double * val) LOCAL;
@@ -64,6 +65,8 @@ extern "C" {
     size_t skipColon(const char * cmd, size_t len) LOCAL;
     scpi_bool_t matchPattern(const char * pattern, size_t pattern_len, const char * str, size_t str_len) LOCAL;
     scpi_bool_t matchCommand(const char * pattern, const char * cmd, size_t len) LOCAL;
+    scpi_bool_t compileCommandIndex(scpi_command_index_t * index, const scpi_command_t * cmdlist) LOCAL;
+    int32_t findIndexedCommand(const scpi_command_index_t * index, const char * cmd, size_t len) LOCAL;
     scpi_bool_t composeCompoundCommand(char * ptr_prev, size_t len_prev, char ** pptr, size_t * plen);
 
 #if !HAVE_STRNLEN
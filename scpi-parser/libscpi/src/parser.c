@@ -222,27 +222,40 @@ static void processCommand(scpi_t * context) {
 }
 
 /**
- * Cycle all patterns and search matching pattern. Execute command callback.
+ * Search matching pattern. Uses compiled command index if it is available,
+ * otherwise cycles all patterns.
  * @param context
  * @result TRUE if context->paramlist is filled with correct values
  */
 static scpi_bool_t findCommand(scpi_t * context, char * cmdline_ptr, size_t cmdline_len, size_t cmd_len) {
     int32_t i;
-    const scpi_command_t * cmd;
-
-    for (i = 0; context->cmdlist[i].pattern != NULL; i++) {
-        cmd = &context->cmdlist[i];
-        if (matchCommand(cmd->pattern, cmdline_ptr, cmd_len)) {
-            context->paramlist.cmd = cmd;
-            context->paramlist.parameters = cmdline_ptr + cmd_len;
-            context->paramlist.length = cmdline_len - cmd_len;
-            context->paramlist.cmd_raw.data = cmdline_ptr;
-            context->paramlist.cmd_raw.length = cmd_len;
-            context->paramlist.cmd_raw.position = 0;
-            return TRUE;
+    const scpi_command_t * cmd = NULL;
+
+    if (context->cmdindex.count > 0) {
+        i = findIndexedCommand(&context->cmdindex, cmdline_ptr, cmd_len);
+        if (i >= 0) {
+            cmd = &context->cmdlist[i];
+        }
+    } else {
+        for (i = 0; context->cmdlist[i].pattern != NULL; i++) {
+            if (matchCommand(context->cmdlist[i].pattern, cmdline_ptr, cmd_len)) {
+                cmd = &context->cmdlist[i];
+                break;
+            }
         }
     }
-    return FALSE;
+
+    if (cmd == NULL) {
+        return FALSE;
+    }
+
+    context->paramlist.cmd = cmd;
+    context->paramlist.parameters = cmdline_ptr + cmd_len;
+    context->paramlist.length = cmdline_len - cmd_len;
+    context->paramlist.cmd_raw.data = cmdline_ptr;
+    context->paramlist.cmd_raw.length = cmd_len;
+    context->paramlist.cmd_raw.position = 0;
+    return TRUE;
 }
 
 /**
@@ -309,7 +322,13 @@ void SCPI_Init(scpi_t * context) {
     }
     
     context->buffer.position = 0;
+    context->buffer.start = 0;
+    context->buffer.scanned = 0;
+    context->buffer.discard = FALSE;
     SCPI_ErrorInit(context);
+
+    /* without index or if it is too small, commands are searched one by one */
+    compileCommandIndex(&context->cmdindex, context->cmdlist);
 }
 
 /**
@@ -317,43 +336,100 @@ void SCPI_Init(scpi_t * context) {
  * command line termination. If the termination is found or if len=0, command
  * parser is called.
  * 
+ * Complete lines are parsed in place. Bytes already searched for a terminator
+ * are not searched again, and the buffer is only compacted, by moving the
+ * incomplete line to its beginning, when new data would not fit.
+ * 
+ * A line that does not fit in the buffer is dropped, together with the rest
+ * of the input up to its terminator, and SCPI_ERROR_INPUT_BUFFER_OVERRUN is
+ * queued. It is never executed.
+ * 
  * @param context
  * @param data - data to process
  * @param len - length of data
- * @return 
+ * @return -1 if input was dropped, else the result of the last parse
  */
 int SCPI_Input(scpi_t * context, const char * data, size_t len) {
     int result = 0;
+    scpi_bool_t overrun = FALSE;
+    scpi_buffer_t * buffer = &context->buffer;
     const char * cmd_term;
+
     if (len == 0) {
-        context->buffer.data[context->buffer.position] = 0;
-        result = SCPI_Parse(context, context->buffer.data, context->buffer.position);
-        context->buffer.position = 0;
-    } else {
-        size_t buffer_free;
-        int ws;
-        buffer_free = context->buffer.length - context->buffer.position;
-        if (len > (buffer_free - 1)) {
-            return -1;
+        buffer->discard = FALSE;
+        buffer->data[buffer->position] = 0;
+        result = SCPI_Parse(context, buffer->data + buffer->start, buffer->position - buffer->start);
+        buffer->position = 0;
+        buffer->start = 0;
+        buffer->scanned = 0;
+        return result;
+    }
+
+    while (len > 0) {
+        size_t room;
+
+        /* the rest of an overlong line is dropped, up to its terminator */
+        if (buffer->discard) {
+            overrun = TRUE;
+            cmd_term = cmdlineTerminator(data, len);
+            if (cmd_term == NULL) {
+                break;
+            }
+            buffer->discard = FALSE;
+            len -= cmd_term - data;
+            data = cmd_term;
         }
-        memcpy(&context->buffer.data[context->buffer.position], data, len);
-        context->buffer.position += len;
-        context->buffer.data[context->buffer.position] = 0;
 
-        ws = skipWhitespace(context->buffer.data, context->buffer.position);
-        cmd_term = cmdlineTerminator(context->buffer.data + ws, context->buffer.position - ws);
+        room = buffer->length - buffer->position - 1;
+        if (len > room && buffer->start > 0) {
+            memmove(buffer->data, buffer->data + buffer->start, buffer->position - buffer->start);
+            buffer->position -= buffer->start;
+            buffer->scanned -= buffer->start;
+            buffer->start = 0;
+            room = buffer->length - buffer->position - 1;
+        }
+
+        if (room == 0) {
+            /* an unterminated line fills the whole buffer */
+            buffer->position = 0;
+            buffer->start = 0;
+            buffer->scanned = 0;
+            buffer->discard = TRUE;
+            SCPI_ErrorPush(context, SCPI_ERROR_INPUT_BUFFER_OVERRUN);
+            continue;
+        }
+        if (room > len) {
+            room = len;
+        }
+
+        memcpy(&buffer->data[buffer->position], data, room);
+        buffer->position += room;
+        buffer->data[buffer->position] = 0;
+        data += room;
+        len -= room;
+
+        cmd_term = cmdlineTerminator(buffer->data + buffer->scanned, buffer->position - buffer->scanned);
         while (cmd_term != NULL) {
-            int curr_len = cmd_term - context->buffer.data;
-            result = SCPI_Parse(context, context->buffer.data + ws, curr_len - ws);
-            memmove(context->buffer.data, cmd_term, context->buffer.position - curr_len);
-            context->buffer.position -= curr_len;
-    
-            ws = skipWhitespace(context->buffer.data, context->buffer.position);
-            cmd_term = cmdlineTerminator(context->buffer.data + ws, context->buffer.position - ws);
+            size_t line_end = cmd_term - buffer->data;
+            size_t ws = skipWhitespace(buffer->data + buffer->start, line_end - buffer->start);
+            result = SCPI_Parse(context, buffer->data + buffer->start + ws, line_end - buffer->start - ws);
+
+            buffer->start = line_end;
+            buffer->start += skipWhitespace(buffer->data + buffer->start, buffer->position - buffer->start);
+            buffer->scanned = buffer->start;
+            cmd_term = cmdlineTerminator(buffer->data + buffer->scanned, buffer->position - buffer->scanned);
+        }
+        buffer->scanned = buffer->position;
+
+        /* everything parsed - start again at the beginning of the buffer */
+        if (buffer->start == buffer->position) {
+            buffer->position = 0;
+            buffer->start = 0;
+            buffer->scanned = 0;
         }
     }
 
-    return result;
+    return overrun ? -1 : result;
 }
 
 /* writing results */
@@ -389,6 +465,44 @@ size_t SCPI_ResultInt(scpi_t * context, int32_t val) {
     return result;
 }
 
+/**
+ * Write unsigned integer value in the given base to the result, with the
+ * #H, #Q or #B prefix for bases 16, 8 and 2
+ * @param context
+ * @param val
+ * @param base  2, 8, 10 or 16
+ * @return 
+ */
+size_t SCPI_ResultUInt32Base(scpi_t * context, uint32_t val, int8_t base) {
+    char buffer[2 + 32 + 1];
+    size_t result = 0;
+    size_t len = 0;
+
+    switch (base) {
+        case 2:
+            buffer[len++] = '#';
+            buffer[len++] = 'B';
+            break;
+        case 8:
+            buffer[len++] = '#';
+            buffer[len++] = 'Q';
+            break;
+        case 16:
+            buffer[len++] = '#';
+            buffer[len++] = 'H';
+            break;
+        default:
+            base = 10;
+            break;
+    }
+
+    len += uint32ToStrBase(val, buffer + len, sizeof (buffer) - len, base);
+    result += writeDelimiter(context);
+    result += writeData(context, buffer, len);
+    context->output_count++;
+    return result;
+}
+
 /**
  * Write boolean value to the result
  * @param context
@@ -103,6 +103,33 @@ size_t longToStr(int32_t val, char * str, size_t len) {
     return pos;
 }
 
+/**
+ * Converts unsigned 32b integer value to string in the given base
+ * @param val   integer value
+ * @param str   converted textual representation
+ * @param len   string buffer length
+ * @param base  output base: 2, 8, 10 or 16
+ * @return number of bytes written to str (without '\0')
+ */
+size_t uint32ToStrBase(uint32_t val, char * str, size_t len, int8_t base) {
+    const char digits[] = "0123456789ABCDEF";
+    uint32_t x = 1;
+    size_t pos = 0;
+
+    while (x <= val / base) {
+        x *= base;
+    }
+
+    do {
+        if (pos < len) str[pos++] = digits[val / x];
+        val %= x;
+        x /= base;
+    } while (x && (pos < len));
+
+    if (pos < len) str[pos] = 0;
+    return pos;
+}
+
 /**
  * Converts double value to string
  * @param val   double value
@@ -616,6 +643,272 @@ scpi_bool_t matchCommand(const char * pattern, const char * cmd, size_t len) {
     return result;
 }
 
+/* maximum number of keywords in one pattern */
+#define PATTERN_KEYWORDS_MAX    8
+/* maximum number of optional [...] groups in one pattern */
+#define PATTERN_OPTIONAL_MAX    4
+
+struct _pattern_keyword_t {
+    const char * keyword;
+    size_t length;
+    int group;
+};
+typedef struct _pattern_keyword_t pattern_keyword_t;
+
+/**
+ * Split pattern to keywords
+ * @param pattern eg. [:MEASure]:VOLTage:DC?
+ * @param keywords - array of at least PATTERN_KEYWORDS_MAX keywords
+ * @param count - number of keywords found
+ * @param groups - number of optional groups found
+ * @param query - TRUE if pattern ends with '?'
+ * @return FALSE if pattern can not be indexed
+ */
+static scpi_bool_t splitPattern(const char * pattern, pattern_keyword_t * keywords,
+        size_t * count, int * groups, scpi_bool_t * query) {
+    const char * ptr = pattern;
+    const char * end = pattern + strlen(pattern);
+    int group = -1;
+
+    *count = 0;
+    *groups = 0;
+    *query = FALSE;
+
+    while (ptr < end) {
+        if (ptr[0] == '[') {
+            if (group >= 0 || *groups >= PATTERN_OPTIONAL_MAX) {
+                return FALSE; /* nested or too many optional keywords */
+            }
+            group = (*groups)++;
+            ptr++;
+        } else if (ptr[0] == ']') {
+            if (group < 0) {
+                return FALSE;
+            }
+            group = -1;
+            ptr++;
+        } else if (ptr[0] == ':') {
+            ptr++;
+        } else if (ptr[0] == '?') {
+            *query = TRUE;
+            ptr++;
+            if (ptr != end) {
+                return FALSE; /* '?' is allowed only at the end */
+            }
+        } else {
+            size_t len = patternSeparatorPos(ptr, end - ptr);
+            if (*count >= PATTERN_KEYWORDS_MAX || len > 255) {
+                return FALSE;
+            }
+            keywords[*count].keyword = ptr;
+            keywords[*count].length = len;
+            keywords[*count].group = group;
+            (*count)++;
+            ptr += len;
+        }
+    }
+
+    return group < 0;
+}
+
+/**
+ * Find child node with given keyword or create new one
+ * @param index
+ * @param parent - parent node
+ * @param keyword
+ * @return node number or SCPI_INDEX_NONE if index is full
+ */
+static uint16_t indexChild(scpi_command_index_t * index, uint16_t parent,
+        const pattern_keyword_t * keyword) {
+    scpi_command_node_t * nodes = index->nodes;
+    uint16_t * link = &nodes[parent].child;
+    scpi_command_node_t * node;
+
+    while (*link != SCPI_INDEX_NONE) {
+        node = &nodes[*link];
+        if ((node->length == keyword->length)
+                && (strncmp(node->keyword, keyword->keyword, keyword->length) == 0)) {
+            return *link;
+        }
+        link = &node->sibling;
+    }
+
+    if (index->count >= index->length || index->count >= SCPI_INDEX_NONE) {
+        return SCPI_INDEX_NONE;
+    }
+
+    node = &nodes[index->count];
+    node->keyword = keyword->keyword;
+    node->length = keyword->length;
+    node->numeric = (keyword->length > 0) && (keyword->keyword[keyword->length - 1] == '#');
+    node->short_length = patternSeparatorShortPos(keyword->keyword,
+            node->numeric ? keyword->length - 1 : keyword->length);
+    node->child = SCPI_INDEX_NONE;
+    node->sibling = SCPI_INDEX_NONE;
+    node->command = SCPI_INDEX_NONE;
+    node->query = SCPI_INDEX_NONE;
+
+    *link = index->count;
+    return index->count++;
+}
+
+/**
+ * Compile command list to keyword tree. Every pattern is expanded to all
+ * combinations of its optional keywords; nodes are shared by commands with
+ * the same keyword path. Earlier commands take precedence, as with
+ * matchCommand over the list.
+ * @param index - index with preallocated nodes
+ * @param cmdlist - command list terminated by SCPI_CMD_LIST_END
+ * @return TRUE if all commands were indexed, FALSE if index is not usable
+ */
+scpi_bool_t compileCommandIndex(scpi_command_index_t * index, const scpi_command_t * cmdlist) {
+    pattern_keyword_t keywords[PATTERN_KEYWORDS_MAX];
+    size_t count;
+    int groups;
+    scpi_bool_t query;
+    int32_t i;
+
+    if (index->nodes == NULL || index->length < 1) {
+        index->count = 0;
+        return FALSE;
+    }
+
+    /* node 0 is root */
+    index->count = 1;
+    index->nodes[0].keyword = "";
+    index->nodes[0].length = 0;
+    index->nodes[0].short_length = 0;
+    index->nodes[0].numeric = FALSE;
+    index->nodes[0].child = SCPI_INDEX_NONE;
+    index->nodes[0].sibling = SCPI_INDEX_NONE;
+    index->nodes[0].command = SCPI_INDEX_NONE;
+    index->nodes[0].query = SCPI_INDEX_NONE;
+
+    for (i = 0; cmdlist[i].pattern != NULL; i++) {
+        unsigned mask;
+
+        if (i >= SCPI_INDEX_NONE
+                || !splitPattern(cmdlist[i].pattern, keywords, &count, &groups, &query)) {
+            index->count = 0;
+            return FALSE;
+        }
+
+        /* each bit of mask selects one optional keyword */
+        for (mask = 0; mask < (1u << groups); mask++) {
+            uint16_t node = 0;
+            uint16_t * terminal;
+            size_t k;
+
+            for (k = 0; k < count; k++) {
+                if ((keywords[k].group >= 0) && !(mask & (1u << keywords[k].group))) {
+                    continue;
+                }
+                node = indexChild(index, node, &keywords[k]);
+                if (node == SCPI_INDEX_NONE) {
+                    index->count = 0;
+                    return FALSE;
+                }
+            }
+
+            terminal = query ? &index->nodes[node].query : &index->nodes[node].command;
+            if (*terminal == SCPI_INDEX_NONE) {
+                *terminal = i;
+            }
+        }
+    }
+
+    return TRUE;
+}
+
+/**
+ * Match one command keyword to index node
+ * @param node
+ * @param str - keyword from command
+ * @param len - length of keyword
+ * @return TRUE if keyword matches short or long form
+ */
+static scpi_bool_t matchNode(const scpi_command_node_t * node, const char * str, size_t len) {
+    if (node->numeric) {
+        return compareStrAndNum(node->keyword, node->length - 1, str, len) ||
+                compareStrAndNum(node->keyword, node->short_length, str, len);
+    } else {
+        return compareStr(node->keyword, node->length, str, len) ||
+                compareStr(node->keyword, node->short_length, str, len);
+    }
+}
+
+/**
+ * Search subtree of index for command
+ * @param index
+ * @param node - node matched so far
+ * @param cmd - rest of command
+ * @param cmd_end - end of command
+ * @return the first command matching or SCPI_INDEX_NONE
+ */
+static uint16_t searchIndex(const scpi_command_index_t * index, uint16_t node,
+        const char * cmd, const char * cmd_end) {
+    const scpi_command_node_t * nodes = index->nodes;
+    uint16_t result = SCPI_INDEX_NONE;
+    uint16_t found;
+    size_t sep;
+
+    if (cmd == cmd_end) {
+        return nodes[node].command;
+    }
+
+    if ((cmd[0] == '?') && (cmd + 1 == cmd_end)) {
+        return nodes[node].query;
+    }
+
+    if (node != 0) {
+        if (cmd[0] != ':') {
+            return SCPI_INDEX_NONE;
+        }
+        cmd++;
+    }
+
+    sep = cmdSeparatorPos(cmd, cmd_end - cmd);
+
+    /* more siblings can match the same keyword, e.g. "ABc" and "ABCD" */
+    for (node = nodes[node].child; node != SCPI_INDEX_NONE; node = nodes[node].sibling) {
+        if (matchNode(&nodes[node], cmd, sep)) {
+            found = searchIndex(index, node, cmd + sep, cmd_end);
+            if (found < result) {
+                result = found;
+            }
+        }
+    }
+
+    return result;
+}
+
+/**
+ * Find command in compiled index
+ * @param index - index compiled by compileCommandIndex
+ * @param cmd - command
+ * @param len - max search length
+ * @return position of command in command list or -1 if not found
+ */
+int32_t findIndexedCommand(const scpi_command_index_t * index, const char * cmd, size_t len) {
+    size_t cmd_len = SCPI_strnlen(cmd, len);
+    uint16_t found;
+
+    if (cmd_len == 0) {
+        return -1;
+    }
+
+    if (cmd[0] == ':') {
+        /* handle errornouse ":*IDN?" */
+        if ((cmd_len >= 2) && (cmd[1] != '*')) {
+            cmd_len--;
+            cmd++;
+        }
+    }
+
+    found = searchIndex(index, 0, cmd, cmd + cmd_len);
+    return (found == SCPI_INDEX_NONE) ? -1 : found;
+}
+
 /**
  * Compose command from previsou command anc current command
  * 
@@ -132,6 +132,8 @@ static char scpi_input_buffer[SCPI_INPUT_BUFFER_LENGTH];
 
 static scpi_reg_val_t scpi_regs[SCPI_REG_COUNT];
 
+#define SCPI_INDEX_LENGTH 64
+static scpi_command_node_t scpi_index_nodes[SCPI_INDEX_LENGTH];
 
 scpi_t scpi_context = {
     .cmdlist = scpi_commands,
@@ -144,6 +146,10 @@ scpi_t scpi_context = {
     .units = scpi_units_def,
     .special_numbers = scpi_special_numbers_def,
     .idn = {"MA", "IN", NULL, "VER"},
+    .cmdindex = {
+        .nodes = scpi_index_nodes,
+        .length = SCPI_INDEX_LENGTH,
+    },
 };
 
 
@@ -164,6 +170,9 @@ void testCommandsHandling(void) {
 }
     output_buffer_clear();
 
+    /* Commands are looked up through the compiled index */
+    CU_ASSERT(scpi_context.cmdindex.count > 0);
+
     /* Test single command */
     TEST_INPUT("*IDN?\r\n", "MA, IN, 0, VER\r\n");
     output_buffer_clear();
@@ -181,7 +190,44 @@ void testCommandsHandling(void) {
     TEST_INPUT("*IDN?", "");
     TEST_INPUT("", "MA, IN, 0, VER\r\n");
     output_buffer_clear();
-    
+
+    /* Test terminator split between buffers */
+    TEST_INPUT("*IDN?\r", "MA, IN, 0, VER\r\n");
+    TEST_INPUT("\n*IDN?\r\n", "MA, IN, 0, VER\r\nMA, IN, 0, VER\r\n");
+    output_buffer_clear();
+
+    /* Test command left over after many lines, moved down to make room */
+    {
+        char data[SCPI_INPUT_BUFFER_LENGTH];
+        size_t i;
+
+        data[0] = '\0';
+        for (i = 0; i < 30; i++) {
+            strcat(data, "*OPC?\r\n");
+        }
+        strcat(data, "*ID");
+        TEST_INPUT(data, "1\r\n1\r\n1\r\n1\r\n1\r\n1\r\n1\r\n1\r\n1\r\n1\r\n"
+                "1\r\n1\r\n1\r\n1\r\n1\r\n1\r\n1\r\n1\r\n1\r\n1\r\n"
+                "1\r\n1\r\n1\r\n1\r\n1\r\n1\r\n1\r\n1\r\n1\r\n1\r\n");
+        output_buffer_clear();
+        TEST_INPUT("N?\r\n*OPC?\r\n*OPC?\r\n*OPC?\r\n*OPC?\r\n*OPC?\r\n*OPC?\r\n*OPC?\r\n",
+                "MA, IN, 0, VER\r\n1\r\n1\r\n1\r\n1\r\n1\r\n1\r\n1\r\n");
+        output_buffer_clear();
+    }
+
+    /* Test long line arriving in a chunk that only fits in part */
+    {
+        char data[SCPI_INPUT_BUFFER_LENGTH];
+
+        memset(data, ' ', 200);
+        data[200] = '\0';
+        TEST_INPUT(data, "");
+        memset(data, ' ', 40);
+        strcpy(data + 40, "*OPC?\r\n*IDN?\r\n");
+        TEST_INPUT(data, "1\r\nMA, IN, 0, VER\r\n");
+        output_buffer_clear();
+    }
+
     CU_ASSERT_EQUAL(err_buffer_pos, 0);
     error_buffer_clear();
     
@@ -205,6 +251,28 @@ void testErrorHandling(void) {
     TEST_ERROR("*IDN? 12\r\n", "MA, IN, 0, VER\r\n", SCPI_ERROR_PARAMETER_NOT_ALLOWED);
     output_buffer_clear();
 
+    /* Line too long for the input buffer is dropped, not executed */
+    {
+        char data[SCPI_INPUT_BUFFER_LENGTH];
+        size_t i;
+
+        strcpy(data, "*IDN?");
+        memset(data + 5, ' ', 195);
+        data[200] = '\0';
+        CU_ASSERT_EQUAL(SCPI_Input(&scpi_context, data, strlen(data)), 0);
+        for (i = 0; i < 2; i++) {
+            CU_ASSERT(SCPI_Input(&scpi_context, data, strlen(data)) < 0);
+        }
+        CU_ASSERT_STRING_EQUAL("", output_buffer);
+        CU_ASSERT_EQUAL(err_buffer_pos, 1);
+        CU_ASSERT_EQUAL(err_buffer[0], SCPI_ERROR_INPUT_BUFFER_OVERRUN);
+        error_buffer_clear();
+
+        /* the rest of the line up to its terminator goes too */
+        TEST_ERROR("*OPC?\r\n*IDN?\r\n", "MA, IN, 0, VER\r\n", 0);
+        output_buffer_clear();
+    }
+
     // TODO: SCPI_ERROR_INVALID_SEPARATOR
     // TODO: SCPI_ERROR_INVALID_SUFFIX
     // TODO: SCPI_ERROR_SUFFIX_NOT_ALLOWED
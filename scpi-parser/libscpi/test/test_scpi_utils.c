@@ -36,6 +36,7 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include "CUnit/Basic.h"
 
 #include "scpi/scpi.h"
@@ -74,6 +75,35 @@ void test_longToStr() {
     CU_ASSERT(str[2] == '\0');
 }
 
+void test_uint32ToStrBase() {
+    char str[33];
+    size_t len;
+
+    len = uint32ToStrBase(0, str, sizeof (str), 16);
+    CU_ASSERT(len == 1);
+    CU_ASSERT(strcmp(str, "0") == 0);
+
+    len = uint32ToStrBase(0x1F40u, str, sizeof (str), 16);
+    CU_ASSERT(len == 4);
+    CU_ASSERT(strcmp(str, "1F40") == 0);
+
+    len = uint32ToStrBase(0xFFFFFFFFu, str, sizeof (str), 16);
+    CU_ASSERT(len == 8);
+    CU_ASSERT(strcmp(str, "FFFFFFFF") == 0);
+
+    len = uint32ToStrBase(8, str, sizeof (str), 8);
+    CU_ASSERT(len == 2);
+    CU_ASSERT(strcmp(str, "10") == 0);
+
+    len = uint32ToStrBase(5, str, sizeof (str), 2);
+    CU_ASSERT(len == 3);
+    CU_ASSERT(strcmp(str, "101") == 0);
+
+    len = uint32ToStrBase(4000000000u, str, sizeof (str), 10);
+    CU_ASSERT(len == 10);
+    CU_ASSERT(strcmp(str, "4000000000") == 0);
+}
+
 void test_doubleToStr() {
     size_t result;
     char str[50];
@@ -297,6 +327,21 @@ void test_matchPattern() {
     TEST_MATCH_PATTERN("AB", "a", FALSE);
 }
 
+/**
+ * Match command through index compiled from single pattern
+ */
+static scpi_bool_t indexMatchCommand(const char * pattern, const char * cmd, size_t len) {
+    scpi_command_node_t nodes[32];
+    scpi_command_index_t index = {nodes, 32, 0};
+    const scpi_command_t cmdlist[] = {
+        {.pattern = pattern, .callback = NULL,},
+        SCPI_CMD_LIST_END
+    };
+
+    CU_ASSERT_TRUE(compileCommandIndex(&index, cmdlist));
+    return findIndexedCommand(&index, cmd, len) == 0;
+}
+
 void test_matchCommand() {
     scpi_bool_t result;
     
@@ -304,6 +349,8 @@ void test_matchCommand() {
     do {                                                        \
         result = matchCommand(p, s, strlen(s));                 \
         CU_ASSERT_EQUAL(result, r);                             \
+        result = indexMatchCommand(p, s, strlen(s));            \
+        CU_ASSERT_EQUAL(result, r);                             \
     } while(0)                                                  \
 
     TEST_MATCH_COMMAND("A", "a", TRUE);
@@ -423,6 +470,56 @@ void test_matchCommand() {
     TEST_MATCH_COMMAND("OUTPut#[:MODulation#]:FM#", "output:fm", TRUE); // test numeric parameter
 }
 
+void test_commandIndex(void) {
+    scpi_command_node_t nodes[32];
+    scpi_command_index_t index = {nodes, 32, 0};
+    const scpi_command_t cmdlist[] = {
+        {.pattern = "*IDN?", .callback = NULL,},
+        {.pattern = "SYSTem:ERRor[:NEXT]?", .callback = NULL,},
+        {.pattern = "SYSTem:ERRor:COUNt?", .callback = NULL,},
+        {.pattern = "MEASure:VOLTage[:DC]", .callback = NULL,},
+        {.pattern = "MEASure:VOLTage[:DC]?", .callback = NULL,},
+        {.pattern = "MEASure:VOLTage:DC?", .callback = NULL,}, /* shadowed */
+        {.pattern = "MEASure:VOLTage:DCRange?", .callback = NULL,},
+        {.pattern = "OUTPut#:STATe", .callback = NULL,},
+        SCPI_CMD_LIST_END
+    };
+
+    #define TEST_INDEX_COMMAND(s, r)                                    \
+    do {                                                                \
+        CU_ASSERT_EQUAL(findIndexedCommand(&index, s, strlen(s)), r);   \
+    } while(0)                                                          \
+
+    CU_ASSERT_TRUE(compileCommandIndex(&index, cmdlist));
+
+    TEST_INDEX_COMMAND("*IDN?", 0);
+    TEST_INDEX_COMMAND("*idn?", 0);
+    TEST_INDEX_COMMAND("*IDN", -1);
+    TEST_INDEX_COMMAND("syst:err?", 1);
+    TEST_INDEX_COMMAND(":SYSTEM:ERROR:NEXT?", 1);
+    TEST_INDEX_COMMAND("syst:err:coun?", 2);
+    TEST_INDEX_COMMAND("syst:err:count", -1);
+    TEST_INDEX_COMMAND("syst", -1);
+    TEST_INDEX_COMMAND("meas:volt", 3);
+    TEST_INDEX_COMMAND("meas:volt:dc", 3);
+    TEST_INDEX_COMMAND("meas:volt?", 4);
+    TEST_INDEX_COMMAND("meas:volt:dc?", 4);
+    TEST_INDEX_COMMAND("meas:volt:dcr?", 6);
+    TEST_INDEX_COMMAND("meas:volt:dcrange?", 6);
+    TEST_INDEX_COMMAND("meas:volt:dcra?", -1);
+    TEST_INDEX_COMMAND("outp:stat", 7);
+    TEST_INDEX_COMMAND("output12:state", 7);
+    TEST_INDEX_COMMAND("outp1a:stat", -1);
+    TEST_INDEX_COMMAND("", -1);
+    TEST_INDEX_COMMAND(":", -1);
+    TEST_INDEX_COMMAND("meas:", -1);
+
+    /* index too small is reported and left unused */
+    index.length = 4;
+    CU_ASSERT_FALSE(compileCommandIndex(&index, cmdlist));
+    CU_ASSERT_EQUAL(index.count, 0);
+}
+
 void test_composeCompoundCommand(void) {
     
 #define TEST_COMPOSE_COMMAND(b, c1_len, c2_pos, c2_len, c2_final, r)    \
@@ -475,6 +572,7 @@ int main() {
     if (0
             || (NULL == CU_add_test(pSuite, "strnpbrk", test_strnpbrk))
             || (NULL == CU_add_test(pSuite, "longToStr", test_longToStr))
+            || (NULL == CU_add_test(pSuite, "uint32ToStrBase", test_uint32ToStrBase))
             || (NULL == CU_add_test(pSuite, "doubleToStr", test_doubleToStr))
             || (NULL == CU_add_test(pSuite, "strToLong", test_strToLong))
             || (NULL == CU_add_test(pSuite, "strToDouble", test_strToDouble))
@@ -484,6 +582,7 @@ int main() {
             || (NULL == CU_add_test(pSuite, "locateStr", test_locateStr))
             || (NULL == CU_add_test(pSuite, "matchPattern", test_matchPattern))
             || (NULL == CU_add_test(pSuite, "matchCommand", test_matchCommand))
+            || (NULL == CU_add_test(pSuite, "commandIndex", test_commandIndex))
             || (NULL == CU_add_test(pSuite, "composeCompoundCommand", test_composeCompoundCommand))
             ) {
         CU_cleanup_registry();
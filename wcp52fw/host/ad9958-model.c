@@ -0,0 +1,181 @@
+/**
+ * \file
+ * Register-level behavioural model of the AD9958
+ */
+
+#include <string.h>
+
+#include "ad9958-model.h"
+
+#define CSR_ADDR 0x00
+#define CFR_ADDR 0x03
+#define READ_BIT 0x80
+
+/**
+ * Register lengths by address, from the AD9958 register map.
+ */
+static const uint8_t REG_LEN[AD9958_NUM_REGS] = {
+    [0x00] = 1, // CSR
+    [0x01] = 3, // FR1
+    [0x02] = 2, // FR2
+    [0x03] = 3, // CFR
+    [0x04] = 4, // CFTW0
+    [0x05] = 2, // CPOW0
+    [0x06] = 3, // ACR
+    [0x07] = 2, // LSRR
+    [0x08] = 4, // RDW
+    [0x09] = 4, // FDW
+    [0x0a] = 4, [0x0b] = 4, [0x0c] = 4, [0x0d] = 4, [0x0e] = 4,
+    [0x0f] = 4, [0x10] = 4, [0x11] = 4, [0x12] = 4, [0x13] = 4,
+    [0x14] = 4, [0x15] = 4, [0x16] = 4, [0x17] = 4, [0x18] = 4, // CW1-15
+};
+
+/**
+ * Whether a register exists separately for each channel.
+ */
+static bool is_channel_reg(uint8_t addr)
+{
+    return addr >= CFR_ADDR;
+}
+
+size_t ad9958_reg_len(uint8_t addr)
+{
+    return addr < AD9958_NUM_REGS ? REG_LEN[addr] : 0;
+}
+
+void ad9958_init(struct ad9958 *dds)
+{
+    memset(dds, 0, sizeof(*dds));
+    ad9958_reset(dds);
+}
+
+void ad9958_reset(struct ad9958 *dds)
+{
+    memset(dds->active, 0, sizeof(dds->active));
+    dds->in_register = false;
+    dds->index = 0;
+
+    for (unsigned ch = 0; ch < 2; ++ch) {
+        // Both channels enabled, 2-wire serial mode
+        dds->active[ch][CSR_ADDR][0] = 0xf0;
+        // DAC full-scale current at maximum, sine output
+        dds->active[ch][CFR_ADDR][1] = 0x03;
+        dds->active[ch][CFR_ADDR][2] = 0x02;
+    }
+    memcpy(dds->buffer, dds->active, sizeof(dds->buffer));
+}
+
+/**
+ * Drop any partly transferred register, counting it if bytes were lost.
+ */
+static void abort_cycle(struct ad9958 *dds)
+{
+    if (dds->in_register) {
+        ++dds->count.framing_errors;
+    }
+    dds->in_register = false;
+    dds->index = 0;
+}
+
+void ad9958_select(struct ad9958 *dds, bool selected)
+{
+    if (selected && !dds->selected) {
+        ++dds->count.transactions;
+    } else if (!selected && dds->selected) {
+        abort_cycle(dds);
+    }
+    dds->selected = selected;
+}
+
+void ad9958_sync_io(struct ad9958 *dds)
+{
+    abort_cycle(dds);
+}
+
+void ad9958_io_update(struct ad9958 *dds)
+{
+    ++dds->count.io_updates;
+
+    // The CSR is never buffered
+    for (unsigned ch = 0; ch < 2; ++ch) {
+        uint8_t csr = dds->active[ch][CSR_ADDR][0];
+        memcpy(dds->active[ch], dds->buffer[ch], sizeof(dds->active[ch]));
+        dds->active[ch][CSR_ADDR][0] = csr;
+    }
+}
+
+/**
+ * Store a completely received register write.
+ */
+static void finish_write(struct ad9958 *dds)
+{
+    uint8_t addr = dds->addr;
+    size_t len = REG_LEN[addr];
+    uint8_t csr = dds->active[0][CSR_ADDR][0];
+
+    ++dds->count.reg_writes;
+
+    if (addr == CSR_ADDR) {
+        dds->active[0][CSR_ADDR][0] = dds->data[0];
+        dds->active[1][CSR_ADDR][0] = dds->data[0];
+        dds->buffer[0][CSR_ADDR][0] = dds->data[0];
+        dds->buffer[1][CSR_ADDR][0] = dds->data[0];
+        return;
+    }
+
+    for (unsigned ch = 0; ch < 2; ++ch) {
+        uint8_t enable = ch ? AD9958_CSR_CH1 : AD9958_CSR_CH0;
+        if (!is_channel_reg(addr) || (csr & enable)) {
+            memcpy(dds->buffer[ch][addr], dds->data, len);
+        }
+    }
+}
+
+uint8_t ad9958_transfer(struct ad9958 *dds, uint8_t in)
+{
+    uint8_t out = 0;
+
+    if (!dds->selected) {
+        return 0;
+    }
+
+    ++dds->count.bytes;
+
+    if (!dds->in_register) {
+        dds->addr = in & ~READ_BIT;
+        dds->reading = in & READ_BIT;
+        dds->index = 0;
+        // Writes to addresses past the map are swallowed one byte at a time
+        dds->in_register = ad9958_reg_len(dds->addr) > 0;
+        return 0;
+    }
+
+    if (dds->reading) {
+        // Reads come from the first enabled channel's active registers
+        unsigned ch = (dds->active[0][CSR_ADDR][0] & AD9958_CSR_CH0) ? 0 : 1;
+        out = dds->active[ch][dds->addr][dds->index];
+    } else {
+        dds->data[dds->index] = in;
+    }
+
+    if (++dds->index == REG_LEN[dds->addr]) {
+        if (dds->reading) {
+            ++dds->count.reg_reads;
+        } else {
+            finish_write(dds);
+        }
+        dds->in_register = false;
+    }
+
+    return out;
+}
+
+uint32_t ad9958_get(const struct ad9958 *dds, unsigned channel, uint8_t addr)
+{
+    uint32_t value = 0;
+
+    for (size_t i = 0; i < ad9958_reg_len(addr); ++i) {
+        value = (value << 8) | dds->active[channel & 1][addr][i];
+    }
+    return value;
+}
@@ -0,0 +1,114 @@
+/**
+ * \file
+ * Register-level behavioural model of the AD9958, for running the synth
+ * driver on a host.
+ *
+ * The model decodes the serial byte stream and the control pins the way the
+ * device does: the CSR selects which channel's registers a write lands in
+ * and takes effect at once, other writes go into I/O buffers, and
+ * IO_UPDATE copies the buffers into the active registers. It counts the
+ * traffic it sees so the cost of driver operations can be measured.
+ */
+
+#ifndef _WCP52_AD9958_MODEL_H
+#define _WCP52_AD9958_MODEL_H 1
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * Number of register addresses, CSR through CW15.
+ */
+#define AD9958_NUM_REGS 0x19
+
+/**
+ * Longest register, in bytes.
+ */
+#define AD9958_MAX_REG_LEN 4
+
+/**
+ * CSR channel enable bits. Note that the driver's channel 0 (CSR 0x82) is
+ * the device's CH1.
+ */
+#define AD9958_CSR_CH0 0x40
+#define AD9958_CSR_CH1 0x80
+
+/**
+ * Traffic counters.
+ */
+struct ad9958_counters {
+    uint32_t bytes;         ///< Bytes clocked in
+    uint32_t transactions;  ///< Chip-select windows
+    uint32_t io_updates;    ///< IO_UPDATE pulses
+    uint32_t reg_writes;    ///< Complete register writes
+    uint32_t reg_reads;     ///< Complete register reads
+    uint32_t framing_errors;    ///< Windows closed part-way through a register
+};
+
+/**
+ * Model state.
+ */
+struct ad9958 {
+    /// Registers in effect; control registers are the same in both rows
+    uint8_t active[2][AD9958_NUM_REGS][AD9958_MAX_REG_LEN];
+    /// Registers written but not yet updated
+    uint8_t buffer[2][AD9958_NUM_REGS][AD9958_MAX_REG_LEN];
+
+    bool selected;      ///< Chip select asserted
+    bool in_register;   ///< An instruction byte has been received
+    bool reading;       ///< The current instruction is a read
+    uint8_t addr;       ///< Register being transferred
+    uint8_t index;      ///< Next byte within the register
+    uint8_t data[AD9958_MAX_REG_LEN];   ///< Bytes received so far
+
+    struct ad9958_counters count;
+};
+
+/**
+ * Length of a register in bytes, or 0 if the address is not a register.
+ */
+size_t ad9958_reg_len(uint8_t addr);
+
+/**
+ * Put the model in its power-on state and clear the counters.
+ */
+void ad9958_init(struct ad9958 *dds);
+
+/**
+ * Master reset: return the registers and serial port to their defaults. The
+ * counters are kept.
+ */
+void ad9958_reset(struct ad9958 *dds);
+
+/**
+ * Chip select changed.
+ * \param selected  true when nCS goes low
+ */
+void ad9958_select(struct ad9958 *dds, bool selected);
+
+/**
+ * SYNC_IO pulse: abort the current I/O cycle.
+ */
+void ad9958_sync_io(struct ad9958 *dds);
+
+/**
+ * IO_UPDATE pulse: make buffered writes active.
+ */
+void ad9958_io_update(struct ad9958 *dds);
+
+/**
+ * Clock one byte through the serial port.
+ * \param in    Byte on SDIO_0
+ * \return  Byte driven on SDIO_2 (0 unless reading)
+ */
+uint8_t ad9958_transfer(struct ad9958 *dds, uint8_t in);
+
+/**
+ * Get an active register as an integer, most significant byte first.
+ * \param channel   Device channel, 0 or 1; ignored for control registers
+ * \param addr      Register address
+ */
+uint32_t ad9958_get(const struct ad9958 *dds, unsigned channel, uint8_t addr);
+
+#endif // _WCP52_AD9958_MODEL_H
@@ -0,0 +1,185 @@
+/**
+ * \file
+ * Host implementations of the ASF functions used by the synth driver
+ */
+
+#include <delay.h>
+#include <pio.h>
+#include <pmc.h>
+#include <spi.h>
+#include <sysclk.h>
+
+#include "conf_board.h"
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "host-board.h"
+
+struct ad9958 G_DDS;
+
+CoreDebug_Type HOST_COREDEBUG;
+DWT_Type HOST_DWT;
+
+// The port is always idle between bytes, and the PDC counter starts at zero
+Spi HOST_SPI = {
+    .SPI_SR = SPI_SR_TDRE | SPI_SR_TXEMPTY | SPI_SR_ENDTX,
+};
+Pdc HOST_SPI_PDC;
+
+Tc HOST_TC0;
+
+// SPI clock divider for the DDS chip select
+static uint32_t G_SPI_DIVIDER = 255;
+
+// Output levels, indexed by pin ID
+static uint8_t G_PIN_LEVEL[96];
+
+// Set while SPI_Handler runs, so interrupts enabled from it are taken after
+// it returns, as on the device
+static bool G_IN_HANDLER = false;
+
+/**
+ * Drive a pin, passing DDS control edges on to the model.
+ */
+static void set_pin(uint32_t pin, uint8_t level)
+{
+    uint8_t was = G_PIN_LEVEL[pin];
+    G_PIN_LEVEL[pin] = level;
+
+    if (level == was) {
+        return;
+    }
+
+    if ((int32_t) pin == GPIO_DDS_nCS) {
+        ad9958_select(&G_DDS, !level);
+    } else if (level && (int32_t) pin == GPIO_DDS_SYNCIO) {
+        ad9958_sync_io(&G_DDS);
+    } else if (level && (int32_t) pin == GPIO_DDS_IOUPDATE) {
+        ad9958_io_update(&G_DDS);
+    } else if (level && (int32_t) pin == GPIO_DDS_MRST) {
+        ad9958_reset(&G_DDS);
+    }
+}
+
+void pio_set_pin_high(uint32_t ul_pin)
+{
+    set_pin(ul_pin, 1);
+}
+
+void pio_set_pin_low(uint32_t ul_pin)
+{
+    set_pin(ul_pin, 0);
+}
+
+uint32_t pio_get_pin_value(uint32_t ul_pin)
+{
+    return G_PIN_LEVEL[ul_pin];
+}
+
+uint32_t pmc_enable_periph_clk(uint32_t ul_id)
+{
+    (void) ul_id;
+    return 0;
+}
+
+// Set once the SPI interrupt is enabled in the NVIC
+static bool G_SPI_IRQ_ENABLED = false;
+
+static void dispatch_irq(void);
+
+void NVIC_EnableIRQ(IRQn_Type irq)
+{
+    if (irq == SPI_IRQn) {
+        G_SPI_IRQ_ENABLED = true;
+        dispatch_irq();
+    }
+}
+
+/**
+ * Take any enabled, pending SPI interrupt.
+ */
+static void dispatch_irq(void)
+{
+    if (G_IN_HANDLER || !(HOST_SPI.SPI_IMR & HOST_SPI.SPI_SR)) {
+        return;
+    }
+
+    // On the device the driver would wait forever for this interrupt
+    if (!G_SPI_IRQ_ENABLED) {
+        fprintf(stderr, "SPI interrupt raised before SPI_IRQn was enabled\n");
+        abort();
+    }
+
+    G_IN_HANDLER = true;
+    while (HOST_SPI.SPI_IMR & HOST_SPI.SPI_SR) {
+        SPI_Handler();
+    }
+    G_IN_HANDLER = false;
+}
+
+/**
+ * Run an enabled PDC transmit to completion.
+ */
+static void run_pdc(void)
+{
+    Pdc *pdc = &HOST_SPI_PDC;
+
+    if (!(pdc->PERIPH_PTCR & PERIPH_PTCR_TXTEN)) {
+        return;
+    }
+
+    const uint8_t *buf = (const uint8_t *) (uintptr_t) pdc->PERIPH_TPR;
+    for (; pdc->PERIPH_TCR; --pdc->PERIPH_TCR) {
+        HOST_SPI.SPI_RDR = ad9958_transfer(&G_DDS, *buf++);
+    }
+    pdc->PERIPH_TPR = (uint32_t) (uintptr_t) buf;
+    pdc->PERIPH_PTCR = 0;
+}
+
+void spi_enable_interrupt(Spi *p_spi, uint32_t ul_sources)
+{
+    run_pdc();
+    p_spi->SPI_IMR |= ul_sources;
+    dispatch_irq();
+}
+
+void spi_disable_interrupt(Spi *p_spi, uint32_t ul_sources)
+{
+    p_spi->SPI_IMR &= ~ul_sources;
+}
+
+uint32_t spi_write(Spi *p_spi, uint16_t us_data, uint8_t uc_pcs,
+        uint8_t uc_last)
+{
+    (void) uc_pcs;
+    (void) uc_last;
+
+    p_spi->SPI_RDR = ad9958_transfer(&G_DDS, us_data);
+    p_spi->SPI_SR |= SPI_SR_RDRF;
+    return 0;
+}
+
+uint32_t spi_read(Spi *p_spi, uint16_t *us_data, uint8_t *p_pcs)
+{
+    *us_data = p_spi->SPI_RDR;
+    *p_pcs = 0;
+    p_spi->SPI_SR &= ~SPI_SR_RDRF;
+    return 0;
+}
+
+int16_t spi_set_baudrate_div(Spi *p_spi, uint32_t ul_pcs_ch,
+        uint8_t uc_baudrate_divider)
+{
+    if (!uc_baudrate_divider) {
+        return -1;
+    }
+    p_spi->SPI_CSR[ul_pcs_ch & 3] = (uint32_t) uc_baudrate_divider << 8;
+    G_SPI_DIVIDER = uc_baudrate_divider;
+    return 0;
+}
+
+uint32_t host_spi_divider(void)
+{
+    return G_SPI_DIVIDER;
+}
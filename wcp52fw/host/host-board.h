@@ -0,0 +1,33 @@
+/**
+ * \file
+ * Host build of the board: the synth driver's pins and SPI port are
+ * connected to an AD9958 model.
+ */
+
+#ifndef _WCP52_HOST_BOARD_H
+#define _WCP52_HOST_BOARD_H 1
+
+#include <inttypes.h>
+
+#include "ad9958-model.h"
+
+/**
+ * The emulated DDS. Call ad9958_init on it before initializing the driver.
+ */
+extern struct ad9958 G_DDS;
+
+/**
+ * SPI clock divider last programmed, for turning byte counts into bus time.
+ */
+uint32_t host_spi_divider(void);
+
+/**
+ * Map a driver channel number to the model's channel. The driver's channel
+ * 0 is enabled by CSR bit 7, which the device calls CH1.
+ */
+static inline unsigned host_dds_channel(unsigned channel)
+{
+    return channel ? 0 : 1;
+}
+
+#endif // _WCP52_HOST_BOARD_H
@@ -0,0 +1,13 @@
+/**
+ * \file
+ * Host stand-in for the ASF delay routines. The model has no timing, so
+ * delays return at once.
+ */
+
+#ifndef _WCP52_HOST_DELAY_H
+#define _WCP52_HOST_DELAY_H 1
+
+#define delay_ms(delay) ((void) (delay))
+#define delay_us(delay) ((void) (delay))
+
+#endif // _WCP52_HOST_DELAY_H
@@ -0,0 +1,122 @@
+/**
+ * \file
+ * Host stand-in for the ASF PIO driver. Pin changes are routed to the
+ * AD9958 model by board-stubs.c.
+ */
+
+#ifndef _WCP52_HOST_PIO_H
+#define _WCP52_HOST_PIO_H 1
+
+#include <inttypes.h>
+
+// Pin IDs, numbered as on the SAM4S
+#define PIO_PA0_IDX 0
+#define PIO_PA1_IDX 1
+#define PIO_PA2_IDX 2
+#define PIO_PA3_IDX 3
+#define PIO_PA4_IDX 4
+#define PIO_PA5_IDX 5
+#define PIO_PA6_IDX 6
+#define PIO_PA7_IDX 7
+#define PIO_PA8_IDX 8
+#define PIO_PA9_IDX 9
+#define PIO_PA10_IDX 10
+#define PIO_PA11_IDX 11
+#define PIO_PA12_IDX 12
+#define PIO_PA13_IDX 13
+#define PIO_PA14_IDX 14
+#define PIO_PA15_IDX 15
+#define PIO_PA16_IDX 16
+#define PIO_PA17_IDX 17
+#define PIO_PA18_IDX 18
+#define PIO_PA19_IDX 19
+#define PIO_PA20_IDX 20
+#define PIO_PA21_IDX 21
+#define PIO_PA22_IDX 22
+#define PIO_PA23_IDX 23
+#define PIO_PA24_IDX 24
+#define PIO_PA25_IDX 25
+#define PIO_PA26_IDX 26
+#define PIO_PA27_IDX 27
+#define PIO_PA28_IDX 28
+#define PIO_PA29_IDX 29
+#define PIO_PA30_IDX 30
+#define PIO_PA31_IDX 31
+#define PIO_PB0_IDX 32
+#define PIO_PB1_IDX 33
+#define PIO_PB2_IDX 34
+#define PIO_PB3_IDX 35
+#define PIO_PB4_IDX 36
+#define PIO_PB5_IDX 37
+#define PIO_PB6_IDX 38
+#define PIO_PB7_IDX 39
+#define PIO_PB8_IDX 40
+#define PIO_PB9_IDX 41
+#define PIO_PB10_IDX 42
+#define PIO_PB11_IDX 43
+#define PIO_PB12_IDX 44
+#define PIO_PB13_IDX 45
+#define PIO_PB14_IDX 46
+#define PIO_PC0_IDX 64
+#define PIO_PC1_IDX 65
+#define PIO_PC2_IDX 66
+#define PIO_PC3_IDX 67
+#define PIO_PC4_IDX 68
+#define PIO_PC5_IDX 69
+#define PIO_PC6_IDX 70
+#define PIO_PC7_IDX 71
+#define PIO_PC8_IDX 72
+#define PIO_PC9_IDX 73
+#define PIO_PC10_IDX 74
+#define PIO_PC11_IDX 75
+#define PIO_PC12_IDX 76
+#define PIO_PC13_IDX 77
+#define PIO_PC14_IDX 78
+#define PIO_PC15_IDX 79
+#define PIO_PC16_IDX 80
+#define PIO_PC17_IDX 81
+#define PIO_PC18_IDX 82
+#define PIO_PC19_IDX 83
+#define PIO_PC20_IDX 84
+#define PIO_PC21_IDX 85
+#define PIO_PC22_IDX 86
+#define PIO_PC23_IDX 87
+#define PIO_PC24_IDX 88
+#define PIO_PC25_IDX 89
+#define PIO_PC26_IDX 90
+#define PIO_PC27_IDX 91
+#define PIO_PC28_IDX 92
+#define PIO_PC29_IDX 93
+#define PIO_PC30_IDX 94
+#define PIO_PC31_IDX 95
+
+// Pin configuration flags, only used to expand the board pin list
+#define PIO_INPUT       0
+#define PIO_OUTPUT_0    0
+#define PIO_OUTPUT_1    0
+#define PIO_PERIPH_A    0
+#define PIO_PULLUP      0
+
+void pio_set_pin_high(uint32_t ul_pin);
+void pio_set_pin_low(uint32_t ul_pin);
+uint32_t pio_get_pin_value(uint32_t ul_pin);
+
+// Core debug registers used by util.h
+typedef struct {
+    volatile uint32_t DEMCR;
+} CoreDebug_Type;
+
+typedef struct {
+    volatile uint32_t CTRL;
+    volatile uint32_t CYCCNT;
+} DWT_Type;
+
+extern CoreDebug_Type HOST_COREDEBUG;
+extern DWT_Type HOST_DWT;
+
+#define CoreDebug (&HOST_COREDEBUG)
+#define DWT (&HOST_DWT)
+#define CoreDebug_DEMCR_TRCENA_Msk (1uL << 24)
+#define DWT_CTRL_CYCCNTENA_Msk (1uL << 0)
+
+#endif // _WCP52_HOST_PIO_H
@@ -0,0 +1,45 @@
+/**
+ * \file
+ * Host stand-in for the ASF PMC driver, and for the timer/counter registers
+ * that the device header brings in with it. The timer never counts, so the
+ * ramp timer interrupt is never taken.
+ */
+
+#ifndef _WCP52_HOST_PMC_H
+#define _WCP52_HOST_PMC_H 1
+
+#include <inttypes.h>
+
+typedef struct {
+    volatile uint32_t TC_CCR;
+    volatile uint32_t TC_CMR;
+    volatile uint32_t TC_RC;
+    volatile uint32_t TC_SR;
+    volatile uint32_t TC_IER;
+    volatile uint32_t TC_IDR;
+} TcChannel;
+
+typedef struct {
+    TcChannel TC_CHANNEL[3];
+} Tc;
+
+extern Tc HOST_TC0;
+
+#define TC0 (&HOST_TC0)
+
+// Peripheral IDs and register bits, as on the SAM4S
+#define ID_TC1 24
+
+#define TC_CCR_CLKEN                (1uL << 0)
+#define TC_CCR_CLKDIS               (1uL << 1)
+#define TC_CCR_SWTRG                (1uL << 2)
+#define TC_CMR_TCCLKS_TIMER_CLOCK4  (3uL << 0)
+#define TC_CMR_WAVSEL_UP_RC         (2uL << 13)
+#define TC_CMR_WAVE                 (1uL << 15)
+#define TC_SR_CPCS                  (1uL << 4)
+#define TC_IER_CPCS                 TC_SR_CPCS
+#define TC_IDR_CPCS                 TC_SR_CPCS
+
+uint32_t pmc_enable_periph_clk(uint32_t ul_id);
+
+#endif // _WCP52_HOST_PMC_H
@@ -0,0 +1,91 @@
+/**
+ * \file
+ * Host stand-in for the ASF SPI driver and SPI peripheral registers. Bytes
+ * written, directly or through the PDC, are clocked through the AD9958
+ * model, and SPI interrupts are delivered by calling SPI_Handler as soon as
+ * they are enabled and pending.
+ */
+
+#ifndef _WCP52_HOST_SPI_H
+#define _WCP52_HOST_SPI_H 1
+
+#include <inttypes.h>
+
+typedef struct {
+    volatile uint32_t SPI_RDR;
+    volatile uint32_t SPI_SR;
+    volatile uint32_t SPI_IMR;
+    volatile uint32_t SPI_CSR[4];
+} Spi;
+
+typedef struct {
+    volatile uint32_t PERIPH_TPR;
+    volatile uint32_t PERIPH_TCR;
+    volatile uint32_t PERIPH_PTCR;
+} Pdc;
+
+extern Spi HOST_SPI;
+extern Pdc HOST_SPI_PDC;
+
+#define SPI (&HOST_SPI)
+
+// Status and interrupt bits, as on the SAM4S
+#define SPI_SR_RDRF     (1uL << 0)
+#define SPI_SR_TDRE     (1uL << 1)
+#define SPI_SR_ENDTX    (1uL << 5)
+#define SPI_SR_TXEMPTY  (1uL << 9)
+#define SPI_IER_ENDTX   SPI_SR_ENDTX
+#define SPI_IER_TXEMPTY SPI_SR_TXEMPTY
+#define SPI_IDR_ENDTX   SPI_SR_ENDTX
+#define SPI_IDR_TXEMPTY SPI_SR_TXEMPTY
+#define SPI_IMR_ENDTX   SPI_SR_ENDTX
+#define SPI_IMR_TXEMPTY SPI_SR_TXEMPTY
+
+#define PERIPH_PTCR_TXTEN   (1uL << 8)
+#define PERIPH_PTCR_TXTDIS  (1uL << 9)
+
+// Interrupt controller
+typedef enum {
+    SPI_IRQn = 21,
+    TC1_IRQn = 24,
+} IRQn_Type;
+
+void NVIC_EnableIRQ(IRQn_Type irq);
+
+void SPI_Handler(void);
+
+static inline Pdc *spi_get_pdc_base(Spi *p_spi)
+{
+    (void) p_spi;
+    return &HOST_SPI_PDC;
+}
+
+static inline uint32_t spi_get_pcs(uint32_t chip_sel)
+{
+    return ~(1uL << chip_sel) & 0xf;
+}
+
+static inline uint32_t spi_read_status(Spi *p_spi)
+{
+    return p_spi->SPI_SR;
+}
+
+static inline uint32_t spi_read_interrupt_mask(Spi *p_spi)
+{
+    return p_spi->SPI_IMR;
+}
+
+static inline uint32_t spi_is_tx_empty(Spi *p_spi)
+{
+    return p_spi->SPI_SR & SPI_SR_TXEMPTY;
+}
+
+void spi_enable_interrupt(Spi *p_spi, uint32_t ul_sources);
+void spi_disable_interrupt(Spi *p_spi, uint32_t ul_sources);
+uint32_t spi_write(Spi *p_spi, uint16_t us_data, uint8_t uc_pcs,
+        uint8_t uc_last);
+uint32_t spi_read(Spi *p_spi, uint16_t *us_data, uint8_t *p_pcs);
+int16_t spi_set_baudrate_div(Spi *p_spi, uint32_t ul_pcs_ch,
+        uint8_t uc_baudrate_divider);
+
+#endif // _WCP52_HOST_SPI_H
@@ -0,0 +1,21 @@
+/**
+ * \file
+ * Host stand-in for the ASF system clock driver, at the board's clock rates.
+ */
+
+#ifndef _WCP52_HOST_SYSCLK_H
+#define _WCP52_HOST_SYSCLK_H 1
+
+#include <inttypes.h>
+
+static inline uint32_t sysclk_get_cpu_hz(void)
+{
+    return 120000000uL;
+}
+
+static inline uint32_t sysclk_get_peripheral_hz(void)
+{
+    return 120000000uL;
+}
+
+#endif // _WCP52_HOST_SYSCLK_H
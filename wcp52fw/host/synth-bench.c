@@ -0,0 +1,199 @@
+/**
+ * \file
+ * Retune cost benchmark. Runs the synth driver against the AD9958 model and
+ * reports the SPI traffic each sweep point costs, checking after every
+ * point that the device ended up with the words the driver meant to send.
+ *
+ * Usage: synth-bench [points]
+ */
+
+#define _POSIX_C_SOURCE 199309L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include <spi.h>
+
+#include "host-board.h"
+#include "synth.h"
+
+/**
+ * Sweep range, in millihertz.
+ */
+#define SWEEP_START_MHZ 1000000000uLL
+#define SWEEP_STOP_MHZ  50000000000uLL
+
+/**
+ * One way of stepping the output through a sweep.
+ */
+struct scenario {
+    const char *name;
+    const char *description;
+    bool verify;    ///< Enable driver readback while running
+    /// Load sweep point i of count; return the driver channels touched
+    unsigned (*step)(unsigned i, unsigned count);
+};
+
+static uint64_t sweep_freq(unsigned i, unsigned count)
+{
+    if (count < 2) {
+        return SWEEP_START_MHZ;
+    }
+    return SWEEP_START_MHZ + (SWEEP_STOP_MHZ - SWEEP_START_MHZ) * i / (count - 1);
+}
+
+static unsigned step_frequency(unsigned i, unsigned count)
+{
+    synth_set_frequency(0, sweep_freq(i, count) / 1000.0);
+    return 1u << 0;
+}
+
+static unsigned step_point(unsigned i, unsigned count)
+{
+    struct synth_point pt;
+    synth_plan_point(&pt, sweep_freq(i, count), 0, 500000);
+    synth_load_point(0, &pt);
+    return 1u << 0;
+}
+
+static unsigned step_point_all(unsigned i, unsigned count)
+{
+    struct synth_point pt;
+    synth_plan_point(&pt, sweep_freq(i, count), i * 1000, 250000 + (i % 2) * 500000);
+    synth_load_point(0, &pt);
+    return 1u << 0;
+}
+
+static unsigned step_both(unsigned i, unsigned count)
+{
+    struct synth_point ref, dut;
+    synth_plan_point(&ref, sweep_freq(i, count), 0, 500000);
+    synth_plan_point(&dut, sweep_freq(i, count), 90000, 500000);
+    synth_load_both(&ref, &dut);
+    return (1u << 0) | (1u << 1);
+}
+
+static const struct scenario SCENARIOS[] = {
+    {"set_frequency", "synth_set_frequency, channel 0", false, step_frequency},
+    {"load_point", "synth_load_point, frequency only", false, step_point},
+    {"load_point_all", "synth_load_point, frequency, phase, amplitude",
+        false, step_point_all},
+    {"load_both", "synth_load_both, coherent pair", false, step_both},
+    {"load_point_verify", "synth_load_point with readback", true, step_point},
+};
+
+/**
+ * Check that the device's active registers hold the driver's view of a
+ * channel.
+ */
+static bool check_channel(unsigned channel)
+{
+    struct synth_point pt;
+    unsigned dev = host_dds_channel(channel);
+
+    synth_get_point(channel, &pt);
+
+    uint32_t ftw = ad9958_get(&G_DDS, dev, CFTW_ADDR);
+    uint32_t pow = ad9958_get(&G_DDS, dev, CPOW_ADDR) & 0x3fff;
+    uint32_t asf = ad9958_get(&G_DDS, dev, CACR_ADDR) & 0x3ff;
+
+    if (ftw != pt.ftw || pow != pt.pow || asf != pt.asf) {
+        fprintf(stderr, "channel %u: device FTW %08"PRIx32" POW %04"PRIx32
+                " ASF %03"PRIx32", expected %08"PRIx32" %04x %03x\n",
+                channel, ftw, pow, asf, pt.ftw, pt.pow, pt.asf);
+        return false;
+    }
+    return true;
+}
+
+static double seconds(const struct timespec *t)
+{
+    return t->tv_sec + t->tv_nsec * 1e-9;
+}
+
+/**
+ * Run a scenario and print its costs.
+ * \return  false if the device disagreed with the driver
+ */
+static bool run(const struct scenario *sc, unsigned count, double sck)
+{
+    struct timespec t0, t1;
+    bool ok = true;
+
+    synth_set_verify(sc->verify);
+
+    // Start each scenario from the same device state
+    struct synth_point idle;
+    synth_plan_point(&idle, 0, 0, 0);
+    synth_load_both(&idle, &idle);
+
+    G_DDS.count = (struct ad9958_counters) {0};
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+
+    for (unsigned i = 0; i < count && ok; ++i) {
+        unsigned channels = sc->step(i, count);
+        for (unsigned ch = 0; ch < 2; ++ch) {
+            if ((channels & (1u << ch)) && !check_channel(ch)) {
+                fprintf(stderr, "%s: mismatch at point %u\n", sc->name, i);
+                ok = false;
+            }
+        }
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    synth_set_verify(false);
+
+    const struct ad9958_counters *c = &G_DDS.count;
+    double n = count;
+    printf("%-18s %7.2f %6.2f %6.2f %6.2f %6.2f %8.2f %8.0f  %s\n",
+            sc->name,
+            c->bytes / n, c->transactions / n, c->io_updates / n,
+            c->reg_writes / n, c->reg_reads / n,
+            c->bytes * 8 / sck * 1e6 / n,
+            (seconds(&t1) - seconds(&t0)) * 1e9 / n,
+            sc->description);
+
+    if (c->framing_errors) {
+        fprintf(stderr, "%s: %"PRIu32" framing errors\n",
+                sc->name, c->framing_errors);
+        ok = false;
+    }
+    if (synth_get_resync_count()) {
+        fprintf(stderr, "%s: driver resynchronized %"PRIu32" times\n",
+                sc->name, synth_get_resync_count());
+        ok = false;
+    }
+    return ok;
+}
+
+int main(int argc, char **argv)
+{
+    unsigned count = 1000;
+    bool ok = true;
+
+    if (argc > 1) {
+        count = strtoul(argv[1], NULL, 0);
+    }
+    if (!count) {
+        fprintf(stderr, "usage: %s [points]\n", argv[0]);
+        return 2;
+    }
+
+    ad9958_init(&G_DDS);
+    // As spi_init does on the device
+    NVIC_EnableIRQ(SPI_IRQn);
+    synth_initialize_interface();
+    synth_initialize_clock();
+    double sck = synth_set_spi_clock(20000000uL);
+
+    printf("%u points per scenario, SPI clock %.3f MHz\n\n", count, sck / 1e6);
+    printf("%-18s %7s %6s %6s %6s %6s %8s %8s\n", "scenario",
+            "bytes", "txns", "upd", "writes", "reads", "bus us", "host ns");
+
+    for (size_t i = 0; i < sizeof(SCENARIOS) / sizeof(SCENARIOS[0]); ++i) {
+        ok = run(&SCENARIOS[i], count, sck) && ok;
+    }
+
+    return ok ? 0 : 1;
+}
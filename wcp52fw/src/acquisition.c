@@ -8,20 +8,83 @@
 #include <pmc.h>
 #include <sysclk.h>
 
+#include <interrupt.h>
+
 #include <inttypes.h>
+#include <limits.h>
+#include <math.h>
 #include "conf_board.h"
 
 #include "acquisition.h"
+#include "dsp.h"
+#include "util.h"
+
+static volatile uint8_t BLOCK_DONE = 1;
+// Buffers handed to the PDC since the capture started
+static uint32_t G_BUFFERS_QUEUED = 0;
+static uint16_t G_BLOCK[2][ACQ_BLOCK_LEN];
+
+// Demultiplexed sample pairs for dual-channel capture
+static uint16_t G_REF[ACQ_BLOCK_LEN / 2];
+static uint16_t G_DUT[ACQ_BLOCK_LEN / 2];
+
+/**
+ * ADC clock periods per conversion, which bounds the trigger rate. The DUT
+ * sample of a pair is taken this much later than the reference sample.
+ */
+#define ADC_CONVERSION_CLOCKS 20
+
+// Sample rate actually programmed into the trigger timer, 0 for free-run
+static double G_SAMPLE_RATE = 0.0;
+
+// Settling detector configuration and last result
+static double G_SETTLE_THRESHOLD = 0.0;
+static double G_SETTLE_TIMEOUT = 0.1;
+static double G_SETTLE_TIME = 0.0;
+static bool G_SETTLED = true;
 
-static volatile uint8_t RECEIVED = 0;
-static volatile uint32_t ADCVAL = 0;
+// Oversampling ratio for decimated captures, and their output buffer
+static uint32_t G_DECIM_RATIO = 1;
+static uint16_t G_DECIM_OUT[ACQ_BLOCK_LEN + 1];
+
+/**
+ * Timer clock prescalers for TIMER_CLOCK1..4, as divisors of MCK.
+ */
+static const uint32_t TC_PRESCALERS[] = {2, 8, 32, 128};
+
+/**
+ * Start sampling, either from the trigger timer or in free-run mode.
+ */
+static void sampling_start(void)
+{
+    if (G_SAMPLE_RATE > 0.0) {
+        ADC->ADC_MR |= ADC_MR_TRGEN;
+        ACQ_TC->TC_CHANNEL[ACQ_TC_CHANNEL].TC_CCR = TC_CCR_CLKEN | TC_CCR_SWTRG;
+    } else {
+        ADC->ADC_MR |= ADC_MR_FREERUN;
+    }
+}
+
+/**
+ * Stop sampling, whichever way it was started.
+ */
+static void sampling_stop(void)
+{
+    ACQ_TC->TC_CHANNEL[ACQ_TC_CHANNEL].TC_CCR = TC_CCR_CLKDIS;
+    ADC->ADC_MR &= ~(ADC_MR_FREERUN | ADC_MR_TRGEN);
+}
 
 void ADC_Handler(void)
 {
-    if (adc_get_status(ADC) & ADC_ISR_DRDY) {
-        uint32_t result = adc_get_latest_value(ADC);
-        ADCVAL = result;
-        RECEIVED = 1;
+    uint32_t status = adc_get_status(ADC);
+    uint32_t mask = adc_get_interrupt_mask(ADC);
+
+    if ((status & ADC_ISR_RXBUFF) && (mask & ADC_IMR_RXBUFF)) {
+        // Both buffers are full. Stop converting so the next capture
+        // starts from a fresh sample.
+        sampling_stop();
+        adc_disable_interrupt(ADC, ADC_IDR_RXBUFF);
+        BLOCK_DONE = 1;
     }
 }
 
@@ -31,25 +94,614 @@ void adc_setup(void)
     adc_init(ADC, sysclk_get_main_hz(), ADC_CLOCK, 8);
     adc_configure_timing(ADC, 0, ADC_SETTLING_TIME_3, 1);
     adc_set_resolution(ADC, ADC_MR_LOWRES_BITS_12);
-    adc_enable_channel(ADC, ADC_CHANNEL_3); // TODO: wrong channel
-    adc_enable_interrupt(ADC, ADC_IER_DRDY);
+    adc_enable_channel(ADC, ACQ_CHANNEL_DUT); // TODO: wrong channel
     adc_configure_trigger(ADC, ADC_TRIG_SW, 0);
     NVIC_EnableIRQ(ADC_IRQn);
-    adc_start(ADC);
+
+    pmc_enable_periph_clk(ACQ_TC_ID);
+}
+
+double acq_get_sample_rate_max(unsigned channels)
+{
+    uint32_t adc_clock = adc_get_actual_adc_clock(ADC, sysclk_get_peripheral_hz());
+    return adc_clock / (double) ADC_CONVERSION_CLOCKS / (channels ? channels : 1);
+}
+
+double acq_set_sample_rate(double rate)
+{
+    TcChannel *tc = &ACQ_TC->TC_CHANNEL[ACQ_TC_CHANNEL];
+    uint32_t mck = sysclk_get_peripheral_hz();
+
+    sampling_stop();
+
+    if (rate <= 0.0 || rate > acq_get_sample_rate_max(1)) {
+        // Back to free-run; the trigger selection is left alone since
+        // TRGEN is clear.
+        G_SAMPLE_RATE = 0.0;
+        return 0.0;
+    }
+
+    // Pick the fastest timer clock whose period fits in the 16-bit counter
+    size_t i;
+    uint32_t rc = 0;
+    for (i = 0; i < sizeof TC_PRESCALERS / sizeof TC_PRESCALERS[0]; ++i) {
+        double ticks = (mck / TC_PRESCALERS[i]) / rate + 0.5;
+        if (ticks <= 0xffff) {
+            rc = (uint32_t) ticks;
+            break;
+        }
+    }
+    if (rc < 2) {
+        G_SAMPLE_RATE = 0.0;
+        return 0.0;
+    }
+
+    // TIOA rises at RA and falls at RC, giving one ADC trigger per period
+    tc->TC_CCR = TC_CCR_CLKDIS;
+    tc->TC_CMR = (i << TC_CMR_TCCLKS_Pos)
+        | TC_CMR_WAVE
+        | TC_CMR_WAVSEL_UP_RC
+        | TC_CMR_ACPA_SET
+        | TC_CMR_ACPC_CLEAR;
+    tc->TC_RA = rc / 2;
+    tc->TC_RC = rc;
+
+    ADC->ADC_MR = (ADC->ADC_MR & ~ADC_MR_TRGSEL_Msk) | ACQ_TC_TRIGGER;
+
+    G_SAMPLE_RATE = (double) (mck / TC_PRESCALERS[i]) / rc;
+    return G_SAMPLE_RATE;
+}
+
+double acq_get_sample_rate(void)
+{
+    return G_SAMPLE_RATE;
+}
+
+/**
+ * Start the PDC on one or two buffers.
+ * \param buf       First buffer
+ * \param count     Number of samples in the first buffer
+ * \param next      Second buffer, or NULL
+ * \param next_count    Number of samples in the second buffer
+ */
+static void capture_start(uint16_t *buf, size_t count,
+        uint16_t *next, size_t next_count)
+{
+    Pdc *pdc = adc_get_pdc_base(ADC);
+
+    pdc->PERIPH_PTCR = PERIPH_PTCR_RXTDIS;
+    BLOCK_DONE = 0;
+    G_BUFFERS_QUEUED = next ? 2 : 1;
+
+    // Discard any stale conversion so it is not the first sample
+    (void) adc_get_latest_value(ADC);
+
+    pdc->PERIPH_RPR = (uint32_t) buf;
+    pdc->PERIPH_RCR = count;
+    pdc->PERIPH_RNPR = (uint32_t) next;
+    pdc->PERIPH_RNCR = next ? next_count : 0;
+    pdc->PERIPH_PTCR = PERIPH_PTCR_RXTEN;
+
+    adc_enable_interrupt(ADC, ADC_IER_RXBUFF);
+    sampling_start();
+}
+
+/**
+ * Queue a buffer to be filled after the one the PDC is working on.
+ * \return true if queued in time, false if the capture already stalled
+ */
+static bool capture_queue(uint16_t *buf, size_t count)
+{
+    Pdc *pdc = adc_get_pdc_base(ADC);
+    bool queued = false;
+
+    irqflags_t flags = cpu_irq_save();
+    if (!BLOCK_DONE && !(adc_get_status(ADC) & ADC_ISR_RXBUFF)) {
+        pdc->PERIPH_RNPR = (uint32_t) buf;
+        pdc->PERIPH_RNCR = count;
+        ++G_BUFFERS_QUEUED;
+        queued = true;
+    }
+    cpu_irq_restore(flags);
+
+    return queued;
+}
+
+/**
+ * Number of buffers the PDC has filled since the capture started. This is
+ * worked out from its counters rather than counted in the interrupt, since
+ * a short buffer can finish right behind the one before it and the two
+ * ENDRX events then merge into one.
+ */
+static uint32_t capture_filled(void)
+{
+    Pdc *pdc = adc_get_pdc_base(ADC);
+
+    // Current counter first: if the PDC moves on between the two reads, the
+    // next counter then reads as empty and the result is still exact
+    uint32_t pending = pdc->PERIPH_RCR ? 1 : 0;
+    pending += pdc->PERIPH_RNCR ? 1 : 0;
+    return G_BUFFERS_QUEUED - pending;
+}
+
+/**
+ * Abort a capture in progress.
+ */
+static void capture_stop(void)
+{
+    adc_disable_interrupt(ADC, ADC_IDR_RXBUFF);
+    sampling_stop();
+    adc_get_pdc_base(ADC)->PERIPH_PTCR = PERIPH_PTCR_RXTDIS;
+    BLOCK_DONE = 1;
+}
+
+void acq_start_block(uint16_t *buf, size_t count)
+{
+    capture_start(buf, count, NULL, 0);
+}
+
+bool acq_block_done(void)
+{
+    return BLOCK_DONE;
+}
+
+void acq_wait_block(void)
+{
+    while (!BLOCK_DONE);
+}
+
+void acq_get_block(uint16_t *buf, size_t count)
+{
+    acq_start_block(buf, count);
+    acq_wait_block();
+}
+
+/**
+ * Start capturing into both internal buffers.
+ * \param remaining Number of samples still wanted
+ * \return  Number of samples queued
+ */
+static size_t capture_start_pair(size_t remaining)
+{
+    size_t first = remaining < ACQ_BLOCK_LEN ? remaining : ACQ_BLOCK_LEN;
+    size_t second = remaining - first < ACQ_BLOCK_LEN ? remaining - first : ACQ_BLOCK_LEN;
+    capture_start(G_BLOCK[0], first, second ? G_BLOCK[1] : NULL, second);
+    return first + second;
+}
+
+/**
+ * Capture samples in blocks; the body of acq_run and acq_stream, without
+ * settling.
+ * \param count     Total number of samples to capture
+ * \param blockfxn  Function called for each block
+ * \param overruns  If NULL, stop when blockfxn falls behind. Otherwise,
+ *                  restart the capture and count the overrun here.
+ * \return  false if samples were lost and overruns is NULL
+ */
+static bool run_blocks(unsigned count,
+        bool (*blockfxn) (const uint16_t *buf, size_t count),
+        uint32_t *overruns)
+{
+    size_t queued, processed = 0;
+    unsigned blocks = 0;
+    bool ok = true;
+
+    if (!count) {
+        return true;
+    }
+
+    queued = capture_start_pair(count);
+
+    while (processed < count) {
+        while (capture_filled() <= blocks);
+
+        uint16_t *buf = G_BLOCK[blocks % 2];
+        size_t n = count - processed < ACQ_BLOCK_LEN ? count - processed : ACQ_BLOCK_LEN;
+
+        if (!blockfxn(buf, n)) {
+            break;
+        }
+        processed += n;
+        ++blocks;
+
+        // The buffer just handled is free again; hand it back to the PDC
+        if (queued < count) {
+            size_t next = count - queued < ACQ_BLOCK_LEN ? count - queued : ACQ_BLOCK_LEN;
+            if (capture_queue(buf, next)) {
+                queued += next;
+            } else if (overruns) {
+                // The PDC stalled with both buffers full. Drop the one not
+                // yet handled and start again from where the data stops.
+                ++*overruns;
+                capture_stop();
+                queued = processed + capture_start_pair(count - processed);
+                blocks = 0;
+            } else {
+                ok = false;
+                break;
+            }
+        }
+    }
+
+    capture_stop();
+    return ok;
+}
+
+/**
+ * Wait for the input to settle if the detector is enabled.
+ */
+static void settle_if_enabled(void)
+{
+    if (G_SETTLE_THRESHOLD > 0.0) {
+        acq_wait_settled(G_SETTLE_THRESHOLD, G_SETTLE_TIMEOUT);
+    }
+}
+
+bool acq_run(unsigned count,
+        bool (*blockfxn) (const uint16_t *buf, size_t count))
+{
+    settle_if_enabled();
+    return run_blocks(count, blockfxn, NULL);
+}
+
+uint32_t acq_stream(unsigned count,
+        bool (*blockfxn) (const uint16_t *buf, size_t count))
+{
+    uint32_t overruns = 0;
+
+    settle_if_enabled();
+    run_blocks(count, blockfxn, &overruns);
+    return overruns;
+}
+
+bool acq_wait_settled(double threshold, double timeout)
+{
+    uint16_t buf[ACQ_SETTLE_BLOCK];
+    struct acq_stats stats;
+    double last_mean = 0.0;
+    unsigned stable = 0;
+    bool settled = false;
+
+    if (timeout > ACQ_SETTLE_TIMEOUT_MAX) {
+        timeout = ACQ_SETTLE_TIMEOUT_MAX;
+    }
+
+    uint32_t hz = sysclk_get_cpu_hz();
+    uint32_t timeout_cycles = timeout * hz;
+    util_cycles_enable();
+    uint32_t start = util_cycles();
+
+    for (unsigned blocks = 0; ; ++blocks) {
+        acq_get_block(buf, ACQ_SETTLE_BLOCK);
+        acq_stats_reset(&stats);
+        acq_stats_add(&stats, buf, ACQ_SETTLE_BLOCK);
+        double mean = acq_stats_mean(&stats);
+
+        if (blocks && fabs(mean - last_mean) <= threshold) {
+            if (++stable >= ACQ_SETTLE_STABLE) {
+                settled = true;
+                break;
+            }
+        } else {
+            stable = 0;
+        }
+        last_mean = mean;
+
+        if (util_cycles() - start >= timeout_cycles) {
+            break;
+        }
+    }
+
+    G_SETTLE_TIME = (double) (util_cycles() - start) / hz;
+    G_SETTLED = settled;
+    return settled;
+}
+
+void acq_set_settling(double threshold, double timeout)
+{
+    G_SETTLE_THRESHOLD = threshold;
+    G_SETTLE_TIMEOUT = timeout;
+}
+
+void acq_get_settling(double *threshold, double *timeout)
+{
+    *threshold = G_SETTLE_THRESHOLD;
+    *timeout = G_SETTLE_TIMEOUT;
+}
+
+bool acq_get_settle_time(double *seconds)
+{
+    *seconds = G_SETTLE_TIME;
+    return G_SETTLED;
+}
+
+bool acq_set_decimation(unsigned ratio)
+{
+    if (ratio < 1 || ratio > DSP_DECIM_MAX) {
+        return false;
+    }
+    G_DECIM_RATIO = ratio;
+    return true;
+}
+
+unsigned acq_get_decimation(void)
+{
+    return G_DECIM_RATIO;
+}
+
+unsigned acq_get_decimated_max(void)
+{
+    return UINT_MAX / G_DECIM_RATIO - (DSP_DECIM_TAPS - 1);
 }
 
+bool acq_run_decimated(unsigned count,
+        bool (*blockfxn) (const uint16_t *buf, size_t count))
+{
+    struct dsp_decim d;
+    unsigned remaining = count;
+
+    bool decimate_block (const uint16_t *buf, size_t n) {
+        size_t n_out = dsp_decim_add(&d, buf, n, G_DECIM_OUT);
+        if (n_out > remaining) {
+            n_out = remaining;
+        }
+        remaining -= n_out;
+        if (n_out && !blockfxn(G_DECIM_OUT, n_out)) {
+            return false;
+        }
+        return remaining > 0;
+    }
+
+    if (!count) {
+        return true;
+    }
+
+    if (count > acq_get_decimated_max()) {
+        return false;
+    }
+
+    dsp_decim_init(&d, G_DECIM_RATIO);
+    return acq_run((count + DSP_DECIM_TAPS - 1) * G_DECIM_RATIO, &decimate_block);
+}
+
+/**
+ * Switch the ADC between single-input and sequenced dual-input capture.
+ * \param dual  true to convert the reference and DUT inputs on every trigger
+ */
+static void sequencer_setup(bool dual)
+{
+    if (dual) {
+        static const enum adc_channel_num_t sequence[] = {
+            ACQ_CHANNEL_REF, ACQ_CHANNEL_DUT,
+        };
+
+        adc_disable_all_channel(ADC);
+        ADC->ADC_SEQR[0] = 0;
+        adc_configure_sequence(ADC, sequence, 2);
+        // With the sequencer on, channel enables select sequence slots
+        adc_enable_channel(ADC, ADC_CHANNEL_0);
+        adc_enable_channel(ADC, ADC_CHANNEL_1);
+        adc_enable_tag(ADC);
+        adc_start_sequencer(ADC);
+    } else {
+        adc_stop_sequencer(ADC);
+        adc_disable_tag(ADC);
+        adc_disable_all_channel(ADC);
+        adc_enable_channel(ADC, ACQ_CHANNEL_DUT);
+    }
+}
+
+bool acq_run_dual(unsigned count,
+        bool (*pairfxn) (const uint16_t *ref, const uint16_t *dut, size_t count))
+{
+    bool in_step = true;
+
+    // Blocks are always an even number of samples, so each one starts on
+    // a reference sample. The tags confirm it.
+    bool split_block (const uint16_t *buf, size_t n) {
+        for (size_t i = 0; i < n / 2; ++i) {
+            uint16_t ref = buf[2 * i], dut = buf[2 * i + 1];
+            if ((ref & ADC_LCDR_CHNB_Msk) >> ADC_LCDR_CHNB_Pos != ACQ_CHANNEL_REF
+                    || (dut & ADC_LCDR_CHNB_Msk) >> ADC_LCDR_CHNB_Pos != ACQ_CHANNEL_DUT) {
+                in_step = false;
+                return false;
+            }
+            G_REF[i] = ref & ADC_LCDR_LDATA_Msk;
+            G_DUT[i] = dut & ADC_LCDR_LDATA_Msk;
+        }
+        return pairfxn(G_REF, G_DUT, n / 2);
+    }
+
+    // Every trigger converts both inputs, which must finish within a period
+    if (G_SAMPLE_RATE > acq_get_sample_rate_max(2)) {
+        return false;
+    }
+
+    settle_if_enabled();
+    sequencer_setup(true);
+    bool ok = run_blocks(2 * count, &split_block, NULL);
+    sequencer_setup(false);
+
+    return ok && in_step;
+}
 
 double acq_get_values (unsigned count)
 {
-    double total = 0.0;
-    size_t n;
-    for (n = 0; n < count; ++n) {
-        RECEIVED = 0;
-        adc_start(ADC);
-        while (!RECEIVED);
-        total += ADCVAL;
+    struct acq_stats stats;
+    acq_get_stats(&stats, count);
+    return acq_stats_mean(&stats);
+}
+
+bool acq_get_stats(struct acq_stats *stats, unsigned count)
+{
+    bool add_block (const uint16_t *buf, size_t n) {
+        acq_stats_add(stats, buf, n);
+        return true;
     }
-    total /= count;
-    return total;
+
+    acq_stats_reset(stats);
+    return acq_run(count, &add_block);
 }
 
+bool acq_get_stats_adaptive(struct acq_stats *stats, double abs_se,
+        double rel_se, unsigned max_count)
+{
+    bool add_block (const uint16_t *buf, size_t n) {
+        acq_stats_add(stats, buf, n);
+        if (stats->count < ACQ_ADAPTIVE_MIN) {
+            return true;
+        }
+
+        // Compare squared standard errors to keep sqrt out of the loop
+        double se_sq = acq_stats_variance(stats) / stats->count;
+        double mean = acq_stats_mean(stats);
+        bool converged = se_sq <= abs_se * abs_se
+            || se_sq <= rel_se * rel_se * mean * mean;
+        return !converged;
+    }
+
+    acq_stats_reset(stats);
+    return acq_run(max_count, &add_block);
+}
+
+bool acq_get_decimated_stats(struct acq_stats *stats, unsigned count)
+{
+    bool add_block (const uint16_t *buf, size_t n) {
+        acq_stats_add(stats, buf, n);
+        return true;
+    }
+
+    acq_stats_reset(stats);
+    return acq_run_decimated(count, &add_block);
+}
+
+bool acq_get_tone(double freq, unsigned count, double *amplitude)
+{
+    struct dsp_goertzel g;
+    double phase;
+
+    bool add_block (const uint16_t *buf, size_t n) {
+        dsp_goertzel_add(&g, buf, n);
+        return true;
+    }
+
+    if (G_SAMPLE_RATE <= 0.0) {
+        return false;
+    }
+
+    dsp_goertzel_init(&g, freq, G_SAMPLE_RATE);
+    bool ok = acq_run(count, &add_block);
+    dsp_goertzel_result(&g, amplitude, &phase);
+    return ok;
+}
+
+bool acq_get_lockin(double freq, double bandwidth, unsigned count,
+        double *amplitude, double *phase)
+{
+    struct dsp_lockin li;
+
+    bool add_block (const uint16_t *buf, size_t n) {
+        dsp_lockin_add(&li, buf, n);
+        return true;
+    }
+
+    if (G_SAMPLE_RATE <= 0.0) {
+        return false;
+    }
+
+    dsp_lockin_init(&li, freq, G_SAMPLE_RATE, bandwidth);
+    bool ok = acq_run(count, &add_block);
+    dsp_lockin_result(&li, amplitude, phase);
+    return ok;
+}
+
+bool acq_get_dual_stats(struct acq_stats *ref, struct acq_stats *dut,
+        unsigned count)
+{
+    bool add_pairs (const uint16_t *ref_buf, const uint16_t *dut_buf, size_t n) {
+        acq_stats_add(ref, ref_buf, n);
+        acq_stats_add(dut, dut_buf, n);
+        return true;
+    }
+
+    acq_stats_reset(ref);
+    acq_stats_reset(dut);
+    return acq_run_dual(count, &add_pairs);
+}
+
+bool acq_get_dual_tone(double freq, unsigned count, double *gain, double *phase)
+{
+    struct dsp_goertzel g_ref, g_dut;
+
+    bool add_pairs (const uint16_t *ref_buf, const uint16_t *dut_buf, size_t n) {
+        dsp_goertzel_add(&g_ref, ref_buf, n);
+        dsp_goertzel_add(&g_dut, dut_buf, n);
+        return true;
+    }
+
+    if (G_SAMPLE_RATE <= 0.0) {
+        return false;
+    }
+
+    dsp_goertzel_init(&g_ref, freq, G_SAMPLE_RATE);
+    dsp_goertzel_init(&g_dut, freq, G_SAMPLE_RATE);
+    bool ok = acq_run_dual(count, &add_pairs);
+
+    // The DUT was sampled one conversion after the reference
+    double skew = ADC_CONVERSION_CLOCKS / (double) adc_get_actual_adc_clock(
+            ADC, sysclk_get_peripheral_hz());
+    dsp_goertzel_relative(&g_ref, &g_dut, freq, skew, gain, phase);
+    return ok;
+}
+
+void acq_stats_reset(struct acq_stats *stats)
+{
+    stats->count = 0;
+    stats->sum = 0;
+    stats->sum_sq = 0;
+    stats->min = UINT16_MAX;
+    stats->max = 0;
+}
+
+void acq_stats_add(struct acq_stats *stats, const uint16_t *buf, size_t count)
+{
+    // A block of up to 65536 16-bit samples cannot overflow a 32-bit sum,
+    // so only the squares need 64-bit adds inside the loop.
+    uint32_t sum = 0;
+    uint64_t sum_sq = 0;
+    uint16_t min = stats->min;
+    uint16_t max = stats->max;
+
+    for (size_t i = 0; i < count; ++i) {
+        uint32_t x = buf[i];
+        sum += x;
+        sum_sq += x * x;
+        if (x < min) min = x;
+        if (x > max) max = x;
+    }
+
+    stats->count += count;
+    stats->sum += sum;
+    stats->sum_sq += sum_sq;
+    stats->min = min;
+    stats->max = max;
+}
+
+double acq_stats_mean(const struct acq_stats *stats)
+{
+    if (!stats->count) {
+        return 0.0;
+    }
+    return (double) stats->sum / stats->count;
+}
+
+double acq_stats_variance(const struct acq_stats *stats)
+{
+    if (stats->count < 2) {
+        return 0.0;
+    }
+    double sum = (double) stats->sum;
+    double var = ((double) stats->sum_sq - sum * sum / stats->count)
+        / (stats->count - 1);
+    return var < 0.0 ? 0.0 : var;
+}
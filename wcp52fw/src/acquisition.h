@@ -6,8 +6,321 @@
 #ifndef _WCP52_ACQUISITION_H
 #define _WCP52_ACQUISITION_H 1
 
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * Number of samples in each of the two internal buffers used by acq_run.
+ */
+#define ACQ_BLOCK_LEN 512
+
+/**
+ * Running statistics over a set of samples. Kept in integers so the
+ * accumulation loop never touches floating point.
+ */
+struct acq_stats {
+    uint32_t count;
+    uint64_t sum;
+    uint64_t sum_sq;
+    uint16_t min;
+    uint16_t max;
+};
+
 void adc_setup(void);
+
+/**
+ * Get the highest sample rate the ADC can keep up with. Triggers that come
+ * faster arrive while a conversion is still running and are dropped.
+ * \param channels  Number of inputs converted on every trigger
+ * \return  Sample rate in Hz
+ */
+double acq_get_sample_rate_max(unsigned channels);
+
+/**
+ * Set a fixed, timer-triggered sample rate.
+ * \param rate      Sample rate in Hz, or 0 to let the ADC free-run. Rates
+ *                  above acq_get_sample_rate_max(1) also free-run.
+ * \return  Sample rate actually programmed, or 0 if free-running
+ */
+double acq_set_sample_rate(double rate);
+
+/**
+ * Get the sample rate set by acq_set_sample_rate.
+ * \return  Sample rate in Hz, or 0 if free-running
+ */
+double acq_get_sample_rate(void);
+
+/**
+ * Start a block capture into a buffer. The PDC fills the buffer without CPU
+ * involvement; poll acq_block_done() or call acq_wait_block() to finish.
+ * \param buf       Destination buffer, must stay valid until completion
+ * \param count     Number of samples to capture, at most 65535
+ */
+void acq_start_block(uint16_t *buf, size_t count);
+
+/**
+ * Check whether the last block capture has completed.
+ */
+bool acq_block_done(void);
+
+/**
+ * Wait for the last block capture to complete.
+ */
+void acq_wait_block(void);
+
+/**
+ * Capture a block of samples, waiting for completion.
+ * \param buf       Destination buffer
+ * \param count     Number of samples to capture, at most 65535
+ */
+void acq_get_block(uint16_t *buf, size_t count);
+
+/**
+ * Number of samples in each block watched by the settling detector.
+ */
+#define ACQ_SETTLE_BLOCK 64
+
+/**
+ * Number of successive block-to-block changes that must be under the
+ * threshold before the input counts as settled.
+ */
+#define ACQ_SETTLE_STABLE 2
+
+/**
+ * Longest settling timeout, in seconds, so the wait fits in the core cycle
+ * counter.
+ */
+#define ACQ_SETTLE_TIMEOUT_MAX 30.0
+
+/**
+ * Wait for the input to settle after a change such as a retune. Short blocks
+ * are captured back to back until the mean moves by no more than the
+ * threshold between successive blocks, ACQ_SETTLE_STABLE times running. The
+ * time taken is kept for acq_get_settle_time.
+ * \param threshold Largest change in block mean, in ADC counts
+ * \param timeout   Longest time to wait, in seconds, at most
+ *                  ACQ_SETTLE_TIMEOUT_MAX
+ * \return  true if the input settled, false on timeout
+ */
+bool acq_wait_settled(double threshold, double timeout);
+
+/**
+ * Enable or disable settling before each acquisition. When enabled,
+ * acq_run and the functions built on it call acq_wait_settled first.
+ * \param threshold Settling threshold in ADC counts, or 0 to disable
+ * \param timeout   Longest time to wait, in seconds
+ */
+void acq_set_settling(double threshold, double timeout);
+
+/**
+ * Get the settings made by acq_set_settling.
+ */
+void acq_get_settling(double *threshold, double *timeout);
+
+/**
+ * Get the result of the last settling wait.
+ * \param seconds   Time spent waiting
+ * \return  true if the input settled, false if the wait timed out
+ */
+bool acq_get_settle_time(double *seconds);
+
+/**
+ * Capture samples without gaps, handing each filled block to a function
+ * while the PDC fills the other buffer.
+ *
+ * Function prototype:
+ * bool fxn(const uint16_t *buf, size_t count);
+ *
+ * Return 'true' to continue capturing, or 'false' to stop early. The
+ * function must finish before the next block fills. If settling is enabled
+ * with acq_set_settling, capture starts once the input has settled.
+ *
+ * \param count     Total number of samples to capture
+ * \param blockfxn  Function called for each block of at most ACQ_BLOCK_LEN
+ * \return  false if blockfxn was too slow and samples were lost
+ */
+bool acq_run(unsigned count,
+        bool (*blockfxn) (const uint16_t *buf, size_t count));
+
+/**
+ * Capture samples continuously for streaming. Like acq_run, except that
+ * when blockfxn falls behind, the unread samples are dropped and capture
+ * restarts rather than stopping; each restart is one overrun. Exactly
+ * count samples are still delivered.
+ * \param count     Total number of samples to deliver
+ * \param blockfxn  Function called for each block of at most ACQ_BLOCK_LEN
+ * \return  Number of overruns
+ */
+uint32_t acq_stream(unsigned count,
+        bool (*blockfxn) (const uint16_t *buf, size_t count));
+
+/**
+ * Capture the reference and DUT inputs interleaved by the ADC sequencer,
+ * handing each block of sample pairs to a function. Every trigger converts
+ * both inputs, so pairs arrive at the configured sample rate.
+ *
+ * Function prototype:
+ * bool fxn(const uint16_t *ref, const uint16_t *dut, size_t count);
+ *
+ * \param count     Number of sample pairs to capture
+ * \param pairfxn   Function called for each block of pairs
+ * \return  false if the sample rate is above acq_get_sample_rate_max(2), or
+ *          if samples were lost or the inputs fell out of step
+ */
+bool acq_run_dual(unsigned count,
+        bool (*pairfxn) (const uint16_t *ref, const uint16_t *dut, size_t count));
+
+/**
+ * Samples taken by acq_get_stats_adaptive before it first checks whether
+ * the mean has converged, so the variance estimate is meaningful.
+ */
+#define ACQ_ADAPTIVE_MIN ACQ_BLOCK_LEN
+
+/**
+ * Capture samples until the standard error of their mean reaches a target,
+ * or a sample limit is hit. Convergence is checked after every block.
+ * \param stats     Statistics to fill
+ * \param abs_se    Target standard error in ADC counts, or 0 for none
+ * \param rel_se    Target standard error relative to the mean, or 0 for none
+ * \param max_count Most samples to capture
+ * \return  false if samples were lost
+ */
+bool acq_get_stats_adaptive(struct acq_stats *stats, double abs_se,
+        double rel_se, unsigned max_count);
+
+/**
+ * Set the oversampling ratio used by acq_run_decimated.
+ * \param ratio     ADC samples per output sample, 1 to DSP_DECIM_MAX
+ * \return  false if the ratio is out of range
+ */
+bool acq_set_decimation(unsigned ratio);
+
+/**
+ * Get the oversampling ratio set by acq_set_decimation.
+ */
+unsigned acq_get_decimation(void);
+
+/**
+ * Most output samples acq_run_decimated can produce at the current
+ * oversampling ratio, limited by the number of ADC samples one capture can
+ * count.
+ */
+unsigned acq_get_decimated_max(void);
+
+/**
+ * Capture samples through the oversample-and-decimate pipeline, handing each
+ * block of 16-bit output samples to a function. Output samples arrive at
+ * the sample rate divided by the oversampling ratio; each ratio of 4 adds
+ * about one bit of effective resolution, given a little noise at the input.
+ *
+ * Function prototype:
+ * bool fxn(const uint16_t *buf, size_t count);
+ *
+ * \param count     Number of output samples to produce, up to
+ *                  acq_get_decimated_max()
+ * \param blockfxn  Function called for each block of output samples
+ * \return  false if count is too large or samples were lost
+ */
+bool acq_run_decimated(unsigned count,
+        bool (*blockfxn) (const uint16_t *buf, size_t count));
+
 double acq_get_values (unsigned count);
 
+/**
+ * Capture samples and compute their statistics in one pass.
+ * \param stats     Statistics to fill
+ * \param count     Number of samples to capture
+ * \return  false if samples were lost
+ */
+bool acq_get_stats(struct acq_stats *stats, unsigned count);
+
+/**
+ * Capture decimated samples and compute their statistics.
+ * \param stats     Statistics to fill, in 16-bit counts
+ * \param count     Number of output samples to capture, up to
+ *                  acq_get_decimated_max()
+ * \return  false if count is too large or samples were lost
+ */
+bool acq_get_decimated_stats(struct acq_stats *stats, unsigned count);
+
+/**
+ * Capture samples and measure the amplitude of the tone at a given frequency
+ * with a Goertzel filter. Requires a fixed sample rate.
+ *
+ * Sampling does not start in step with the DDS, so the phase of a single
+ * input means nothing and is not returned. Use acq_get_dual_tone for phase.
+ * \param freq      Frequency of the tone, in Hz
+ * \param count     Number of samples to capture
+ * \param amplitude Peak amplitude, in ADC counts
+ * \return  false if no sample rate is set or samples were lost
+ */
+bool acq_get_tone(double freq, unsigned count, double *amplitude);
+
+/**
+ * Capture samples and run them through a lock-in amplifier referenced to a
+ * given frequency. Requires a fixed sample rate.
+ *
+ * Each call is a separate measurement: the reference oscillator and output
+ * filters start afresh and the result is the filter output at the end of
+ * the capture. Sampling stops between captures and does not start in step
+ * with the DDS, so the reference phase cannot be carried from one capture
+ * to the next.
+ * \param freq      Reference frequency, in Hz
+ * \param bandwidth Lock-in output filter bandwidth, in Hz
+ * \param count     Number of samples to capture
+ * \param amplitude Peak amplitude, in ADC counts
+ * \param phase     Phase relative to the reference, in degrees
+ * \return  false if no sample rate is set or samples were lost
+ */
+bool acq_get_lockin(double freq, double bandwidth, unsigned count,
+        double *amplitude, double *phase);
+
+/**
+ * Capture the reference and DUT inputs together and compute statistics for
+ * each.
+ * \param ref       Statistics of the reference input
+ * \param dut       Statistics of the DUT input
+ * \param count     Number of sample pairs to capture
+ * \return  false if samples were lost
+ */
+bool acq_get_dual_stats(struct acq_stats *ref, struct acq_stats *dut,
+        unsigned count);
+
+/**
+ * Capture the reference and DUT inputs together and measure the tone at a
+ * given frequency on each. The DUT phase is corrected for the sequencer's
+ * conversion delay. Requires a fixed sample rate.
+ * \param freq      Frequency of the tone, in Hz
+ * \param count     Number of sample pairs to capture
+ * \param gain      DUT amplitude over reference amplitude
+ * \param phase     DUT phase minus reference phase, in degrees
+ * \return  false if no sample rate is set or samples were lost
+ */
+bool acq_get_dual_tone(double freq, unsigned count, double *gain, double *phase);
+
+/**
+ * Clear a statistics accumulator.
+ */
+void acq_stats_reset(struct acq_stats *stats);
+
+/**
+ * Add a block of samples to a statistics accumulator.
+ * \param stats     Accumulator
+ * \param buf       Samples
+ * \param count     Number of samples in buf
+ */
+void acq_stats_add(struct acq_stats *stats, const uint16_t *buf, size_t count);
+
+/**
+ * Mean of the accumulated samples, in ADC counts.
+ */
+double acq_stats_mean(const struct acq_stats *stats);
+
+/**
+ * Unbiased sample variance of the accumulated samples, in ADC counts squared.
+ */
+double acq_stats_variance(const struct acq_stats *stats);
+
 
 #endif // _WCP52_ACQUISITION_H
@@ -5,6 +5,25 @@
 
 #define ADC_CLOCK       6400000
 
+// Timer channel that triggers the ADC in fixed-rate mode. Its TIOA output
+// must match the ADC trigger selection.
+#define ACQ_TC          TC0
+#define ACQ_TC_CHANNEL  0
+#define ACQ_TC_ID       ID_TC0
+#define ACQ_TC_TRIGGER  ADC_MR_TRGSEL_ADC_TRIG1
+
+// Timer channel whose compare interrupt paces software amplitude ramps
+#define SYNTH_RAMP_TC           TC0
+#define SYNTH_RAMP_TC_CHANNEL   1
+#define SYNTH_RAMP_TC_ID        ID_TC1
+#define SYNTH_RAMP_TC_IRQn      TC1_IRQn
+#define SYNTH_RAMP_TC_Handler   TC1_Handler
+
+// ADC inputs. The DUT input is the main level input (GPIO_LEVEL); dual
+// capture also needs the reference level on its own pin (GPIO_LEVEL_REF).
+#define ACQ_CHANNEL_DUT ADC_CHANNEL_3
+#define ACQ_CHANNEL_REF ADC_CHANNEL_2
+
 #define PIN_LIST \
 XPINGROUP("Pins for optional FTDI FT230")\
 XPIN(GPIO_nSLEEP,       PA0,    PIO_INPUT,              "USB #SLEEP indication")\
@@ -22,6 +41,7 @@ XPINGROUP("Instrument control")\
 XPIN(GPIO_CHANSEL,      PA2,    PIO_OUTPUT_0,           "Input channel select")\
 XPIN(GPIO_ATTEN,        PC14,   PIO_OUTPUT_0,           "Output attenuator enable")\
 XPIN(GPIO_LEVEL,        PA20,   PIO_INPUT,              "Main analog dB level input")\
+XPIN(GPIO_LEVEL_REF,    PA19,   PIO_INPUT,              "Reference analog dB level input")\
 XPINGROUP("AD9958 interface")\
 XPIN(GPIO_DDS_SYNCIO,   PA5,    PIO_OUTPUT_0,           "Resets IO interface")\
 XPIN(GPIO_DDS_nCS,      PA6,    PIO_OUTPUT_1,           "SPI chip select (active low)")\
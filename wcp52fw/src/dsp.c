@@ -0,0 +1,308 @@
+/**
+ * \file
+ * Signal processing on captured sample blocks
+ */
+
+#include <math.h>
+
+#include "dsp.h"
+
+// Not provided by math.h in strict C99 mode
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+/**
+ * Compute sum(e^(-jwn)) for n = 0 .. N-1.
+ * \param w     Frequency, radians per sample
+ * \param n     Number of terms
+ * \param re    Real part of the result
+ * \param im    Imaginary part of the result
+ */
+static void geometric_sum(double w, double n, double *re, double *im)
+{
+    // (1 - e^(-jwN)) / (1 - e^(-jw))
+    double nr = 1.0 - cos(w * n), ni = sin(w * n);
+    double dr = 1.0 - cos(w), di = sin(w);
+    double den = dr * dr + di * di;
+
+    if (den < 1e-20) {
+        *re = n;
+        *im = 0.0;
+    } else {
+        *re = (nr * dr + ni * di) / den;
+        *im = (ni * dr - nr * di) / den;
+    }
+}
+
+void dsp_goertzel_init(struct dsp_goertzel *g, double freq, double rate)
+{
+    g->w = 2.0 * M_PI * freq / rate;
+    g->coeff = 4.0 * sin(g->w / 2) * sin(g->w / 2);
+    g->xr = 0.0;
+    g->xi = 0.0;
+    g->count = 0;
+    g->sum = 0;
+}
+
+void dsp_goertzel_add(struct dsp_goertzel *g, const uint16_t *buf, size_t count)
+{
+    // The recurrence runs in float one block at a time; each block's result
+    // is then folded into the double total, so rounding error does not grow
+    // with the length of the capture. It is written in terms of
+    // k = 2 - 2 cos(w), which keeps its precision at low frequencies where
+    // 2 cos(w) would round to 2.
+    float s1 = 0.0f;
+    float s2 = 0.0f;
+    float coeff = g->coeff;
+    int32_t sum = 0;
+
+    if (!count) {
+        return;
+    }
+
+    for (size_t i = 0; i < count; ++i) {
+        int32_t x = (int32_t) buf[i] - DSP_ADC_MIDSCALE;
+        float s0 = x + (s1 - s2) + (s1 - coeff * s1);
+        s2 = s1;
+        s1 = s0;
+        sum += x;
+    }
+
+    // y = s1 - s2 e^(-jw) is the block's DFT rotated by e^(jw(n-1)); undo
+    // that and shift it to the first sample of the whole capture.
+    double w = g->w;
+    double yr = s1 - s2 * cos(w);
+    double yi = s2 * sin(w);
+    double rot = -w * ((double) g->count + count - 1);
+    double c = cos(rot), s = sin(rot);
+    g->xr += yr * c - yi * s;
+    g->xi += yr * s + yi * c;
+
+    g->count += count;
+    g->sum += sum;
+}
+
+void dsp_goertzel_result(const struct dsp_goertzel *g,
+        double *amplitude, double *phase)
+{
+    if (!g->count) {
+        *amplitude = 0.0;
+        *phase = 0.0;
+        return;
+    }
+
+    double w = g->w;
+    double n = g->count;
+    double xr = g->xr;
+    double xi = g->xi;
+
+    // Remove the DC term's leakage into this bin
+    double mean = g->sum / n;
+    double sr, si;
+    geometric_sum(w, n, &sr, &si);
+    xr -= mean * sr;
+    xi -= mean * si;
+
+    // A real tone c e^(jwn) + conj(c) e^(-jwn) gives X = cN + conj(c) S2,
+    // where S2 is the leakage of the negative-frequency image. Solve for c
+    // so that captures of a non-integer number of cycles are still exact.
+    geometric_sum(2.0 * w, n, &sr, &si);
+    double den = n * n - (sr * sr + si * si);
+    if (den > 1e-9 * n * n) {
+        double cr = (xr * n - (sr * xr + si * xi)) / den;
+        double ci = (xi * n - (si * xr - sr * xi)) / den;
+        xr = cr * n;
+        xi = ci * n;
+    }
+
+    *amplitude = 2.0 * sqrt(xr * xr + xi * xi) / n;
+    *phase = atan2(xi, xr) * (180.0 / M_PI);
+}
+
+void dsp_goertzel_relative(const struct dsp_goertzel *ref,
+        const struct dsp_goertzel *dut, double freq, double skew,
+        double *gain, double *phase)
+{
+    double amp_ref, amp_dut, ph_ref, ph_dut;
+
+    dsp_goertzel_result(ref, &amp_ref, &ph_ref);
+    dsp_goertzel_result(dut, &amp_dut, &ph_dut);
+
+    // Sampling the DUT late adds 360 f skew to the phase it shows at its
+    // first sample; take that back off
+    ph_dut -= 360.0 * freq * skew;
+
+    *gain = amp_ref > 0.0 ? amp_dut / amp_ref : 0.0;
+    *phase = ph_dut - ph_ref;
+    while (*phase > 180.0) *phase -= 360.0;
+    while (*phase <= -180.0) *phase += 360.0;
+}
+
+void dsp_biquad_lowpass(struct dsp_biquad *bq, double fc, double rate, double q)
+{
+    // Bilinear-transform low-pass from the RBJ audio EQ cookbook
+    double w0 = 2.0 * M_PI * fc / rate;
+    double alpha = sin(w0) / (2.0 * q);
+    double cw = cos(w0);
+    double a0 = 1.0 + alpha;
+
+    bq->b0 = (1.0 - cw) / 2.0 / a0;
+    bq->b1 = (1.0 - cw) / a0;
+    bq->b2 = bq->b0;
+    bq->a1 = 2.0 * cw / a0;
+    bq->a2 = -(1.0 - alpha) / a0;
+    bq->x1 = bq->x2 = bq->y1 = bq->y2 = 0.0f;
+}
+
+/**
+ * Run one sample through a biquad section.
+ */
+static inline float biquad_step(struct dsp_biquad *bq, float x)
+{
+    float y = bq->b0 * x + bq->b1 * bq->x1 + bq->b2 * bq->x2
+        + bq->a1 * bq->y1 + bq->a2 * bq->y2;
+    bq->x2 = bq->x1;
+    bq->x1 = x;
+    bq->y2 = bq->y1;
+    bq->y1 = y;
+    return y;
+}
+
+void dsp_lockin_init(struct dsp_lockin *li, double freq, double rate,
+        double bandwidth)
+{
+    // Pole Q values of a fourth-order Butterworth response
+    static const double butterworth_q[DSP_LOCKIN_STAGES] = {0.54119610, 1.30656296};
+
+    // Filtering at the full sample rate would put the poles so close to 1
+    // that float coefficients lose the filter's DC gain, so the mixer
+    // output is averaged down first.
+    double decim = rate / (bandwidth * DSP_LOCKIN_OVERSAMPLE);
+    li->decim = decim < 1.0 ? 1 : (uint32_t) decim;
+
+    li->w = 2.0 * M_PI * freq / rate;
+    li->count = 0;
+    li->phase = 0;
+    li->acc_i = 0.0f;
+    li->acc_q = 0.0f;
+    li->out_i = 0.0f;
+    li->out_q = 0.0f;
+    for (size_t i = 0; i < DSP_LOCKIN_STAGES; ++i) {
+        dsp_biquad_lowpass(&li->filt_i[i], bandwidth, rate / li->decim,
+                butterworth_q[i]);
+        dsp_biquad_lowpass(&li->filt_q[i], bandwidth, rate / li->decim,
+                butterworth_q[i]);
+    }
+}
+
+void dsp_lockin_add(struct dsp_lockin *li, const uint16_t *buf, size_t count)
+{
+    // The reference oscillator is a phasor rotated in float. It is
+    // recomputed exactly at the start of every block, so its phase error
+    // cannot build up over a long capture.
+    double start = fmod(li->w * li->count, 2.0 * M_PI);
+    float ref_c = cos(start), ref_s = sin(start);
+    float step_c = cos(li->w), step_s = sin(li->w);
+    float acc_i = li->acc_i, acc_q = li->acc_q;
+    uint32_t phase = li->phase;
+    uint32_t decim = li->decim;
+
+    for (size_t n = 0; n < count; ++n) {
+        float x = (int32_t) buf[n] - DSP_ADC_MIDSCALE;
+
+        // Mix with e^(-jwn)
+        acc_i += x * ref_c;
+        acc_q -= x * ref_s;
+
+        if (++phase == decim) {
+            float out_i = acc_i / decim;
+            float out_q = acc_q / decim;
+            for (size_t i = 0; i < DSP_LOCKIN_STAGES; ++i) {
+                out_i = biquad_step(&li->filt_i[i], out_i);
+                out_q = biquad_step(&li->filt_q[i], out_q);
+            }
+            li->out_i = out_i;
+            li->out_q = out_q;
+            acc_i = acc_q = 0.0f;
+            phase = 0;
+        }
+
+        float c = ref_c * step_c - ref_s * step_s;
+        ref_s = ref_s * step_c + ref_c * step_s;
+        ref_c = c;
+    }
+
+    li->acc_i = acc_i;
+    li->acc_q = acc_q;
+    li->phase = phase;
+    li->count += count;
+}
+
+void dsp_lockin_result(const struct dsp_lockin *li,
+        double *amplitude, double *phase)
+{
+    // The filtered mixer output is half the tone's complex amplitude
+    *amplitude = 2.0 * sqrt((double) li->out_i * li->out_i
+            + (double) li->out_q * li->out_q);
+    *phase = atan2(li->out_q, li->out_i) * (180.0 / M_PI);
+}
+
+void dsp_decim_init(struct dsp_decim *d, uint32_t ratio)
+{
+    d->ratio = ratio;
+    d->phase = 0;
+    d->acc = 0;
+    d->fill = 0;
+    for (size_t i = 0; i < DSP_DECIM_TAPS; ++i) {
+        d->hist[i] = 0;
+    }
+}
+
+size_t dsp_decim_add(struct dsp_decim *d, const uint16_t *in, size_t count,
+        uint16_t *out)
+{
+    // Binomial low-pass, unity gain at DC. It takes out what the boxcar's
+    // sinc response leaves near the output Nyquist frequency.
+    static const uint32_t taps[DSP_DECIM_TAPS] = {1, 4, 6, 4, 1};
+    const uint32_t taps_shift = 4;
+
+    uint32_t ratio = d->ratio;
+    uint32_t phase = d->phase;
+    uint32_t acc = d->acc;
+    size_t n_out = 0;
+
+    for (size_t n = 0; n < count; ++n) {
+        acc += in[n];
+        if (++phase < ratio) {
+            continue;
+        }
+
+        // Scale the 12-bit sum up to 16 bits, rounding to nearest. The sum
+        // of DSP_DECIM_MAX samples still fits comfortably in 32 bits.
+        uint16_t box = (uint16_t) (((acc << 4) + ratio / 2) / ratio);
+        acc = 0;
+        phase = 0;
+
+        for (size_t i = DSP_DECIM_TAPS - 1; i > 0; --i) {
+            d->hist[i] = d->hist[i - 1];
+        }
+        d->hist[0] = box;
+
+        if (d->fill < DSP_DECIM_TAPS) {
+            if (++d->fill < DSP_DECIM_TAPS) {
+                continue;
+            }
+        }
+
+        uint32_t y = 0;
+        for (size_t i = 0; i < DSP_DECIM_TAPS; ++i) {
+            y += taps[i] * d->hist[i];
+        }
+        out[n_out++] = (uint16_t) ((y + (1u << (taps_shift - 1))) >> taps_shift);
+    }
+
+    d->phase = phase;
+    d->acc = acc;
+    return n_out;
+}
@@ -0,0 +1,189 @@
+/**
+ * \file
+ * Signal processing on captured sample blocks
+ */
+
+#ifndef _WCP52_DSP_H
+#define _WCP52_DSP_H 1
+
+#include <inttypes.h>
+#include <stddef.h>
+
+/**
+ * ADC code for zero signal, subtracted before processing so the float
+ * accumulators stay small.
+ */
+#define DSP_ADC_MIDSCALE 2048
+
+/**
+ * Goertzel single-bin DFT state.
+ */
+struct dsp_goertzel {
+    double w;       ///< Normalized frequency, radians per sample
+    float coeff;    ///< 2 - 2 cos(w)
+    double xr, xi;  ///< DFT so far, referenced to the first sample
+    uint32_t count; ///< Samples processed
+    int64_t sum;    ///< Sum of samples, relative to midscale
+};
+
+/**
+ * Prepare a Goertzel filter.
+ * \param g     Filter state
+ * \param freq  Frequency to detect, in Hz
+ * \param rate  Sample rate, in Hz
+ */
+void dsp_goertzel_init(struct dsp_goertzel *g, double freq, double rate);
+
+/**
+ * Run a block of ADC samples through a Goertzel filter. Blocks must be
+ * contiguous in time.
+ * \param g     Filter state
+ * \param buf   Samples
+ * \param count Number of samples in buf
+ */
+void dsp_goertzel_add(struct dsp_goertzel *g, const uint16_t *buf, size_t count);
+
+/**
+ * Get the amplitude and phase of the tone seen by a Goertzel filter. The DC
+ * component of the input is removed first.
+ * \param g         Filter state
+ * \param amplitude Peak amplitude, in ADC counts
+ * \param phase     Phase at the first sample, in degrees
+ */
+void dsp_goertzel_result(const struct dsp_goertzel *g,
+        double *amplitude, double *phase);
+
+/**
+ * Get the gain and phase of one input relative to another from two Goertzel
+ * filters tuned to the same tone, such as over the two halves of an
+ * interleaved capture.
+ * \param ref       Filter over the reference samples
+ * \param dut       Filter over the DUT samples
+ * \param freq      Tone frequency, in Hz
+ * \param skew      Time by which each DUT sample follows its reference
+ *                  sample, in seconds
+ * \param gain      DUT amplitude over reference amplitude, 0 without a
+ *                  reference
+ * \param phase     DUT phase relative to the reference, in degrees, above
+ *                  -180 and up to 180
+ */
+void dsp_goertzel_relative(const struct dsp_goertzel *ref,
+        const struct dsp_goertzel *dut, double freq, double skew,
+        double *gain, double *phase);
+
+/**
+ * Direct form I biquad section. Coefficients follow the CMSIS-DSP sign
+ * convention: y = b0 x[n] + b1 x[n-1] + b2 x[n-2] + a1 y[n-1] + a2 y[n-2].
+ */
+struct dsp_biquad {
+    float b0, b1, b2, a1, a2;
+    float x1, x2, y1, y2;
+};
+
+/**
+ * Number of biquad sections in each lock-in output filter.
+ */
+#define DSP_LOCKIN_STAGES 2
+
+/**
+ * Minimum ratio of the lock-in filter sample rate to its bandwidth. The
+ * mixer output is averaged down to about this rate before filtering.
+ */
+#define DSP_LOCKIN_OVERSAMPLE 50
+
+/**
+ * Digital lock-in (I/Q demodulator) state.
+ */
+struct dsp_lockin {
+    double w;       ///< Reference frequency, radians per sample
+    uint32_t count; ///< Samples processed
+    uint32_t decim; ///< Mixer samples averaged per filter sample
+    uint32_t phase; ///< Position within the current average
+    float acc_i, acc_q; ///< Mixer output sums for the current average
+    struct dsp_biquad filt_i[DSP_LOCKIN_STAGES];
+    struct dsp_biquad filt_q[DSP_LOCKIN_STAGES];
+    float out_i, out_q; ///< Latest filtered I and Q
+};
+
+/**
+ * Configure a biquad section as a low-pass filter and clear its state.
+ * \param bq    Biquad section
+ * \param fc    Cutoff frequency, in Hz
+ * \param rate  Sample rate, in Hz
+ * \param q     Quality factor
+ */
+void dsp_biquad_lowpass(struct dsp_biquad *bq, double fc, double rate, double q);
+
+/**
+ * Prepare a lock-in. The output filter is a fourth-order Butterworth
+ * low-pass; allow a few multiples of 1/bandwidth for it to settle.
+ * \param li        Lock-in state
+ * \param freq      Reference frequency, in Hz
+ * \param rate      Sample rate, in Hz
+ * \param bandwidth Output filter cutoff, in Hz
+ */
+void dsp_lockin_init(struct dsp_lockin *li, double freq, double rate,
+        double bandwidth);
+
+/**
+ * Run a block of ADC samples through a lock-in. Blocks must be contiguous
+ * in time.
+ * \param li    Lock-in state
+ * \param buf   Samples
+ * \param count Number of samples in buf
+ */
+void dsp_lockin_add(struct dsp_lockin *li, const uint16_t *buf, size_t count);
+
+/**
+ * Get the current amplitude and phase seen by a lock-in.
+ * \param li        Lock-in state
+ * \param amplitude Peak amplitude, in ADC counts
+ * \param phase     Phase relative to the reference, in degrees
+ */
+void dsp_lockin_result(const struct dsp_lockin *li,
+        double *amplitude, double *phase);
+
+/**
+ * Largest oversampling ratio accepted by the decimator.
+ */
+#define DSP_DECIM_MAX 256
+
+/**
+ * Number of taps in the FIR that follows the decimator's boxcar stage.
+ */
+#define DSP_DECIM_TAPS 5
+
+/**
+ * Oversample-and-decimate state. A boxcar sum over each group of ADC samples
+ * is followed by a short FIR at the decimated rate; the output is scaled to
+ * a full 16-bit range.
+ */
+struct dsp_decim {
+    uint32_t ratio; ///< ADC samples per output sample
+    uint32_t phase; ///< Position within the current boxcar sum
+    uint32_t acc;   ///< Boxcar sum so far
+    uint32_t fill;  ///< Boxcar outputs seen, saturating at DSP_DECIM_TAPS
+    uint16_t hist[DSP_DECIM_TAPS]; ///< Recent boxcar outputs, newest first
+};
+
+/**
+ * Prepare a decimator.
+ * \param d     Decimator state
+ * \param ratio Oversampling ratio, 1 to DSP_DECIM_MAX
+ */
+void dsp_decim_init(struct dsp_decim *d, uint32_t ratio);
+
+/**
+ * Run a block of ADC samples through a decimator. Blocks must be contiguous
+ * in time. The first DSP_DECIM_TAPS - 1 boxcar outputs only fill the FIR and
+ * produce nothing.
+ * \param d     Decimator state
+ * \param in    ADC samples
+ * \param count Number of samples in in
+ * \param out   Output samples, room for count / ratio + 1
+ * \return  Number of samples written to out
+ */
+size_t dsp_decim_add(struct dsp_decim *d, const uint16_t *in, size_t count,
+        uint16_t *out);
+
+#endif // _WCP52_DSP_H
@@ -16,6 +16,7 @@
 #include <spi_master.h>
 #include <stdio_usb.h>
 #include <sysclk.h>
+#include <udi_cdc.h>
 #include "conf_board.h"
 #include "usb-functions.h"
 
@@ -69,6 +70,10 @@ static void spi_init(void)
     spi_set_transfer_delay(SPI_MASTER_BASE, SPI_CHIP_SEL, SPI_DLYBS,
             SPI_DLYBCT);
     spi_enable(SPI_MASTER_BASE);
+
+    // DDS transfers run on the PDC and finish in SPI_Handler, so the
+    // interrupt must be live before the first one
+    NVIC_EnableIRQ(SPI_IRQn);
 }
 
 /**
@@ -84,6 +89,49 @@ static void pins_init(void)
     for_each_pin (&configure_pin, NULL);
 }
 
+/**
+ * Pass whatever the host has sent to the SCPI parser, or sleep until the USB
+ * interrupt brings more.
+ */
+static void receive_commands(void)
+{
+    char chunk[UDI_CDC_DATA_EPS_FS_SIZE];
+
+    // Checked with interrupts off, so data arriving before the WFI still
+    // wakes it
+    cpu_irq_disable();
+    iram_size_t avail = G_CDC_ENABLED ? udi_cdc_get_nb_received_data() : 0;
+    if (!avail) {
+        __WFI();
+    }
+    cpu_irq_enable();
+
+    if (!avail) {
+        return;
+    }
+
+    size_t len = avail < sizeof(chunk) ? avail : sizeof(chunk);
+    len -= udi_cdc_read_buf(chunk, len);
+
+    // Drop NUL bytes, which some terminals send as padding
+    size_t kept = 0;
+    for (size_t i = 0; i < len; ++i) {
+        if (chunk[i]) {
+            chunk[kept++] = chunk[i];
+        }
+    }
+    len = kept;
+
+    // A zero length would tell SCPI_Input to parse an unfinished line
+    if (!len) {
+        return;
+    }
+
+    // A line longer than the input buffer is dropped up to its terminator
+    // and queues an input buffer overrun error
+    SCPI_Input(&G_SCPI_CONTEXT, chunk, len);
+}
+
 /**
  * Main function.
  *
@@ -97,39 +145,15 @@ int main(void)
     cpu_irq_enable();
     board_init();
     spi_init();
+    synth_ramp_setup();
     adc_setup();
     stdio_usb_init();
     pio_set_pin_high(GPIO_LED1);
     
     SCPI_Init(&G_SCPI_CONTEXT);
 
-    const size_t SMBUFFER_SIZE = 10;
-    char smbuffer[10];
     for (;;) {
-        // Get into smbuffer until either full, or a \r or \n
-        size_t i;
-        i = 0;
-        while (i < SMBUFFER_SIZE - 1) {
-            char ch = 0;
-            if (G_CDC_ENABLED) {
-                ch = udi_cdc_getc();
-            } else {
-                continue;
-            }
-            if (!ch) {
-                continue;
-            }
-            if (ch == '\r' || ch == '\n') {
-                smbuffer[i] = ch;
-                ++i;
-                break;
-            } else {
-                smbuffer[i] = ch;
-                ++i;
-            }
-        }
-        smbuffer[i] = 0; // Terminate!
-        SCPI_Input(&G_SCPI_CONTEXT, smbuffer, strlen (smbuffer));
+        receive_commands();
     }
 
     return 0;
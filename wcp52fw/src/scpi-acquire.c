@@ -0,0 +1,546 @@
+/**
+ * \file
+ * \brief SCPI ACQuire:* commands
+ */
+
+// Atmel ASF includes
+#include <udi_cdc.h>
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include "scpi/scpi.h"
+#include "scpi-def.h"
+#include "scpi-acquire.h"
+#include "acquisition.h"
+#include "synth.h"
+#include "usb-functions.h"
+
+// Overruns during the last ACQuire:STReam?
+static uint32_t G_STREAM_OVERRUNS = 0;
+
+/**
+ * SCPI: Set the ADC sample rate.
+ * ACQuire:SRATe rate
+ *
+ * A rate of 0 lets the ADC free-run as fast as it can convert. Rates the
+ * ADC cannot convert at are rejected; dual-input captures need a rate no
+ * more than half that limit.
+ *
+ * \param context   Active SCPI context
+ * \return  Success or failure
+ */
+scpi_result_t ACQ_SRATE(scpi_t *context)
+{
+    scpi_number_t rate;
+
+    if (!SCPI_ParamNumber(context, &rate, true)) {
+        return SCPI_RES_ERR;
+    }
+
+    if (rate.value < 0.0 || rate.value > acq_get_sample_rate_max(1)) {
+        SCPI_ErrorPush(context, SCPI_ERROR_ILLEGAL_PARAMETER_VALUE);
+        return SCPI_RES_ERR;
+    }
+
+    if (acq_set_sample_rate(rate.value) == 0.0 && rate.value != 0.0) {
+        SCPI_ErrorPush(context, SCPI_ERROR_ILLEGAL_PARAMETER_VALUE);
+        return SCPI_RES_ERR;
+    }
+
+    return SCPI_RES_OK;
+}
+
+/**
+ * SCPI: Query the ADC sample rate actually in use.
+ * ACQuire:SRATe?
+ *
+ * \param context   Active SCPI context
+ * \return  Success or failure
+ */
+scpi_result_t ACQ_SRATE_Q(scpi_t *context)
+{
+    SCPI_ResultDouble(context, acq_get_sample_rate());
+    return SCPI_RES_OK;
+}
+
+/**
+ * SCPI: Sample the input and report its statistics.
+ * ACQuire:STATistics? count
+ *
+ * Returns mean, variance, minimum and maximum in ADC counts.
+ *
+ * \param context   Active SCPI context
+ * \return  Success or failure
+ */
+scpi_result_t ACQ_STATS_Q(scpi_t *context)
+{
+    int32_t num_samples;
+    struct acq_stats stats;
+
+    if (!SCPI_ParamInt(context, &num_samples, true)) {
+        return SCPI_RES_ERR;
+    }
+
+    if (num_samples < 1) {
+        SCPI_ErrorPush(context, SCPI_ERROR_ILLEGAL_PARAMETER_VALUE);
+        return SCPI_RES_ERR;
+    }
+
+    if (!acq_get_stats(&stats, num_samples)) {
+        SCPI_ErrorPush(context, SCPI_ERROR_EXECUTION_ERROR);
+        return SCPI_RES_ERR;
+    }
+
+    SCPI_ResultDouble(context, acq_stats_mean(&stats));
+    SCPI_ResultDouble(context, acq_stats_variance(&stats));
+    SCPI_ResultInt(context, stats.min);
+    SCPI_ResultInt(context, stats.max);
+    return SCPI_RES_OK;
+}
+
+/**
+ * SCPI: Configure settling before each acquisition.
+ * ACQuire:SETtle threshold[, timeout]
+ *
+ * When threshold is nonzero, every acquisition first waits until the mean
+ * of successive short blocks changes by no more than threshold ADC counts,
+ * or until timeout seconds (default 0.1) have passed. 0 disables settling.
+ *
+ * \param context   Active SCPI context
+ * \return  Success or failure
+ */
+scpi_result_t ACQ_SETTLE(scpi_t *context)
+{
+    double threshold, timeout;
+
+    acq_get_settling(&threshold, &timeout);
+
+    if (!SCPI_ParamDouble(context, &threshold, true)) {
+        return SCPI_RES_ERR;
+    }
+
+    if (!SCPI_ParamDouble(context, &timeout, false) && context->cmd_error) {
+        return SCPI_RES_ERR;
+    }
+
+    if (threshold < 0.0 || timeout <= 0.0 || timeout > ACQ_SETTLE_TIMEOUT_MAX) {
+        SCPI_ErrorPush(context, SCPI_ERROR_ILLEGAL_PARAMETER_VALUE);
+        return SCPI_RES_ERR;
+    }
+
+    acq_set_settling(threshold, timeout);
+    return SCPI_RES_OK;
+}
+
+/**
+ * SCPI: Query the settling configuration.
+ * ACQuire:SETtle?
+ *
+ * Returns threshold in ADC counts and timeout in seconds.
+ *
+ * \param context   Active SCPI context
+ * \return  Success or failure
+ */
+scpi_result_t ACQ_SETTLE_Q(scpi_t *context)
+{
+    double threshold, timeout;
+
+    acq_get_settling(&threshold, &timeout);
+    SCPI_ResultDouble(context, threshold);
+    SCPI_ResultDouble(context, timeout);
+    return SCPI_RES_OK;
+}
+
+/**
+ * SCPI: Report the last settling wait.
+ * ACQuire:SETtle:TIME?
+ *
+ * Returns the time spent waiting in seconds, and 1 if the input settled or
+ * 0 if the wait timed out.
+ *
+ * \param context   Active SCPI context
+ * \return  Success or failure
+ */
+scpi_result_t ACQ_SETTLE_TIME_Q(scpi_t *context)
+{
+    double seconds;
+    bool settled = acq_get_settle_time(&seconds);
+
+    SCPI_ResultDouble(context, seconds);
+    SCPI_ResultInt(context, settled);
+    return SCPI_RES_OK;
+}
+
+/**
+ * SCPI: Average the input until the mean is known to a given precision.
+ * ACQuire:AVERage? max_count, abs_se[, rel_se]
+ *
+ * Sampling stops once the standard error of the mean is at most abs_se ADC
+ * counts or rel_se times the mean, whichever comes first, or after max_count
+ * samples. Pass 0 to disable either target. Returns mean, standard error and
+ * the number of samples used.
+ *
+ * \param context   Active SCPI context
+ * \return  Success or failure
+ */
+scpi_result_t ACQ_AVERAGE_Q(scpi_t *context)
+{
+    int32_t max_samples;
+    double abs_se;
+    double rel_se = 0.0;
+    struct acq_stats stats;
+
+    if (!SCPI_ParamInt(context, &max_samples, true)) {
+        return SCPI_RES_ERR;
+    }
+
+    if (!SCPI_ParamDouble(context, &abs_se, true)) {
+        return SCPI_RES_ERR;
+    }
+
+    if (!SCPI_ParamDouble(context, &rel_se, false) && context->cmd_error) {
+        return SCPI_RES_ERR;
+    }
+
+    if (max_samples < 1 || abs_se < 0.0 || rel_se < 0.0) {
+        SCPI_ErrorPush(context, SCPI_ERROR_ILLEGAL_PARAMETER_VALUE);
+        return SCPI_RES_ERR;
+    }
+
+    if (!acq_get_stats_adaptive(&stats, abs_se, rel_se, max_samples)) {
+        return SCPI_RES_ERR;
+    }
+
+    double se = stats.count ? sqrt(acq_stats_variance(&stats) / stats.count) : 0.0;
+    SCPI_ResultDouble(context, acq_stats_mean(&stats));
+    SCPI_ResultDouble(context, se);
+    SCPI_ResultInt(context, stats.count);
+    return SCPI_RES_OK;
+}
+
+/**
+ * SCPI: Set the oversampling ratio for decimated acquisitions.
+ * ACQuire:DECimate ratio
+ *
+ * \param context   Active SCPI context
+ * \return  Success or failure
+ */
+scpi_result_t ACQ_DECIMATE(scpi_t *context)
+{
+    int32_t ratio;
+
+    if (!SCPI_ParamInt(context, &ratio, true)) {
+        return SCPI_RES_ERR;
+    }
+
+    if (ratio < 1 || !acq_set_decimation(ratio)) {
+        SCPI_ErrorPush(context, SCPI_ERROR_ILLEGAL_PARAMETER_VALUE);
+        return SCPI_RES_ERR;
+    }
+
+    return SCPI_RES_OK;
+}
+
+/**
+ * SCPI: Query the oversampling ratio.
+ * ACQuire:DECimate?
+ *
+ * \param context   Active SCPI context
+ * \return  Success or failure
+ */
+scpi_result_t ACQ_DECIMATE_Q(scpi_t *context)
+{
+    SCPI_ResultInt(context, acq_get_decimation());
+    return SCPI_RES_OK;
+}
+
+/**
+ * SCPI: Sample the input through the oversample-and-decimate pipeline and
+ * report the statistics of the output.
+ * ACQuire:HIRes:STATistics? count
+ *
+ * count is the number of output samples. Returns mean, variance, minimum and
+ * maximum in 16-bit counts (ADC counts times 16). count times the
+ * oversampling ratio must fit in 32 bits.
+ *
+ * \param context   Active SCPI context
+ * \return  Success or failure
+ */
+scpi_result_t ACQ_HIRES_STATS_Q(scpi_t *context)
+{
+    int32_t num_samples;
+    struct acq_stats stats;
+
+    if (!SCPI_ParamInt(context, &num_samples, true)) {
+        return SCPI_RES_ERR;
+    }
+
+    if (num_samples < 1 || (unsigned) num_samples > acq_get_decimated_max()) {
+        SCPI_ErrorPush(context, SCPI_ERROR_ILLEGAL_PARAMETER_VALUE);
+        return SCPI_RES_ERR;
+    }
+
+    if (!acq_get_decimated_stats(&stats, num_samples)) {
+        return SCPI_RES_ERR;
+    }
+
+    SCPI_ResultDouble(context, acq_stats_mean(&stats));
+    SCPI_ResultDouble(context, acq_stats_variance(&stats));
+    SCPI_ResultInt(context, stats.min);
+    SCPI_ResultInt(context, stats.max);
+    return SCPI_RES_OK;
+}
+
+/**
+ * SCPI: Measure the stimulus tone on the input.
+ * ACQuire:TONE? count[, channel]
+ *
+ * Runs a Goertzel filter at the frequency last set on the given DDS channel
+ * (default 0). Returns peak amplitude in ADC counts. Sampling does not start
+ * in step with the DDS, so no phase is returned; ACQuire:DUAL:TONE? measures
+ * phase against the reference input.
+ * Requires a sample rate set with ACQuire:SRATe.
+ *
+ * \param context   Active SCPI context
+ * \return  Success or failure
+ */
+scpi_result_t ACQ_TONE_Q(scpi_t *context)
+{
+    int32_t num_samples;
+    int32_t ch = 0;
+    double amplitude;
+
+    if (!SCPI_ParamInt(context, &num_samples, true)) {
+        return SCPI_RES_ERR;
+    }
+
+    if (!SCPI_ParamInt(context, &ch, false) && context->cmd_error) {
+        return SCPI_RES_ERR;
+    }
+
+    if (num_samples < 1 || ch < 0 || ch > 1) {
+        SCPI_ErrorPush(context, SCPI_ERROR_ILLEGAL_PARAMETER_VALUE);
+        return SCPI_RES_ERR;
+    }
+
+    if (!acq_get_tone(synth_get_frequency(ch), num_samples, &amplitude)) {
+        return SCPI_RES_ERR;
+    }
+
+    SCPI_ResultDouble(context, amplitude);
+    return SCPI_RES_OK;
+}
+
+/**
+ * SCPI: Measure the stimulus tone on the input with a lock-in amplifier.
+ * ACQuire:LOCKin? count, bandwidth[, channel]
+ *
+ * Demodulates the input against the frequency last set on the given DDS
+ * channel (default 0) and low-pass filters I and Q to the given bandwidth.
+ * Returns peak amplitude in ADC counts and phase in degrees. The count
+ * should cover several multiples of 1/bandwidth so the filter settles.
+ * Requires a sample rate set with ACQuire:SRATe.
+ *
+ * Every query is a fresh measurement; filter state is not kept between
+ * queries. For a continuously updated reading, repeat the query.
+ *
+ * \param context   Active SCPI context
+ * \return  Success or failure
+ */
+scpi_result_t ACQ_LOCKIN_Q(scpi_t *context)
+{
+    int32_t num_samples;
+    scpi_number_t bandwidth;
+    int32_t ch = 0;
+    double amplitude, phase;
+
+    if (!SCPI_ParamInt(context, &num_samples, true)) {
+        return SCPI_RES_ERR;
+    }
+
+    if (!SCPI_ParamNumber(context, &bandwidth, true)) {
+        return SCPI_RES_ERR;
+    }
+
+    if (!SCPI_ParamInt(context, &ch, false) && context->cmd_error) {
+        return SCPI_RES_ERR;
+    }
+
+    if (num_samples < 1 || ch < 0 || ch > 1
+            || bandwidth.value <= 0.0
+            || bandwidth.value >= acq_get_sample_rate() / 4) {
+        SCPI_ErrorPush(context, SCPI_ERROR_ILLEGAL_PARAMETER_VALUE);
+        return SCPI_RES_ERR;
+    }
+
+    if (!acq_get_lockin(synth_get_frequency(ch), bandwidth.value, num_samples,
+                &amplitude, &phase)) {
+        return SCPI_RES_ERR;
+    }
+
+    SCPI_ResultDouble(context, amplitude);
+    SCPI_ResultDouble(context, phase);
+    return SCPI_RES_OK;
+}
+
+/**
+ * SCPI: Sample the reference and DUT inputs together and report their
+ * statistics.
+ * ACQuire:DUAL:STATistics? count
+ *
+ * Returns reference mean and variance, then DUT mean and variance, in ADC
+ * counts.
+ *
+ * \param context   Active SCPI context
+ * \return  Success or failure
+ */
+scpi_result_t ACQ_DUAL_STATS_Q(scpi_t *context)
+{
+    int32_t num_samples;
+    struct acq_stats ref, dut;
+
+    if (!SCPI_ParamInt(context, &num_samples, true)) {
+        return SCPI_RES_ERR;
+    }
+
+    if (num_samples < 1) {
+        SCPI_ErrorPush(context, SCPI_ERROR_ILLEGAL_PARAMETER_VALUE);
+        return SCPI_RES_ERR;
+    }
+
+    if (!acq_get_dual_stats(&ref, &dut, num_samples)) {
+        return SCPI_RES_ERR;
+    }
+
+    SCPI_ResultDouble(context, acq_stats_mean(&ref));
+    SCPI_ResultDouble(context, acq_stats_variance(&ref));
+    SCPI_ResultDouble(context, acq_stats_mean(&dut));
+    SCPI_ResultDouble(context, acq_stats_variance(&dut));
+    return SCPI_RES_OK;
+}
+
+/**
+ * SCPI: Measure the gain and phase between the reference and DUT inputs.
+ * ACQuire:DUAL:TONE? count[, channel]
+ *
+ * Both inputs are captured in one acquisition and run through Goertzel
+ * filters at the frequency last set on the given DDS channel (default 0).
+ * Returns DUT/reference amplitude ratio and DUT minus reference phase in
+ * degrees. Requires a sample rate set with ACQuire:SRATe.
+ *
+ * \param context   Active SCPI context
+ * \return  Success or failure
+ */
+scpi_result_t ACQ_DUAL_TONE_Q(scpi_t *context)
+{
+    int32_t num_samples;
+    int32_t ch = 0;
+    double gain, phase;
+
+    if (!SCPI_ParamInt(context, &num_samples, true)) {
+        return SCPI_RES_ERR;
+    }
+
+    if (!SCPI_ParamInt(context, &ch, false) && context->cmd_error) {
+        return SCPI_RES_ERR;
+    }
+
+    if (num_samples < 1 || ch < 0 || ch > 1) {
+        SCPI_ErrorPush(context, SCPI_ERROR_ILLEGAL_PARAMETER_VALUE);
+        return SCPI_RES_ERR;
+    }
+
+    if (!acq_get_dual_tone(synth_get_frequency(ch), num_samples, &gain, &phase)) {
+        return SCPI_RES_ERR;
+    }
+
+    SCPI_ResultDouble(context, gain);
+    SCPI_ResultDouble(context, phase);
+    return SCPI_RES_OK;
+}
+
+/**
+ * SCPI: Stream raw samples to the host.
+ * ACQuire:STReam? count
+ *
+ * Sends count samples as an IEEE 488.2 definite-length block: '#', the
+ * number of length digits, the length in bytes, then the samples as
+ * little-endian 16-bit ADC counts. Samples go straight to the USB link while
+ * the next block is captured. If the link falls behind, samples are dropped
+ * and counted (see ACQuire:STReam:OVERruns?), and an execution error is
+ * queued since the block then has gaps. If the link goes down, the block is
+ * cut short and an execution error is queued.
+ *
+ * \param context   Active SCPI context
+ * \return  Success or failure
+ */
+scpi_result_t ACQ_STREAM_Q(scpi_t *context)
+{
+    int32_t num_samples;
+    char header[16];
+    bool sent = true;
+
+    bool send_block (const uint16_t *buf, size_t n) {
+        sent = !udi_cdc_write_buf(buf, n * sizeof(*buf));
+        return sent;
+    }
+
+    if (!SCPI_ParamInt(context, &num_samples, true)) {
+        return SCPI_RES_ERR;
+    }
+
+    if (num_samples < 1) {
+        SCPI_ErrorPush(context, SCPI_ERROR_ILLEGAL_PARAMETER_VALUE);
+        return SCPI_RES_ERR;
+    }
+
+    if (!G_CDC_ENABLED) {
+        SCPI_ErrorPush(context, SCPI_ERROR_EXECUTION_ERROR);
+        return SCPI_RES_ERR;
+    }
+
+    // Anything already printed must go out ahead of the block
+    fflush(stdout);
+    SCPI_Flush(context);
+
+    unsigned long len = (unsigned long) num_samples * sizeof(uint16_t);
+    int digits = snprintf(header, sizeof(header), "%lu", len);
+    snprintf(header, sizeof(header), "#%d%lu", digits, len);
+    if (udi_cdc_write_buf(header, strlen(header))) {
+        SCPI_ErrorPush(context, SCPI_ERROR_EXECUTION_ERROR);
+        return SCPI_RES_ERR;
+    }
+
+    G_STREAM_OVERRUNS = acq_stream(num_samples, &send_block);
+
+    // A short block can't be repaired once its length is sent; the error
+    // tells the host not to trust it
+    if (!sent || udi_cdc_write_buf("\r\n", 2)) {
+        SCPI_ErrorPush(context, SCPI_ERROR_EXECUTION_ERROR);
+        return SCPI_RES_ERR;
+    }
+
+    // The block is whole but not continuous
+    if (G_STREAM_OVERRUNS) {
+        SCPI_ErrorPush(context, SCPI_ERROR_EXECUTION_ERROR);
+        return SCPI_RES_ERR;
+    }
+    return SCPI_RES_OK;
+}
+
+/**
+ * SCPI: Query the overrun count of the last stream.
+ * ACQuire:STReam:OVERruns?
+ *
+ * Returns the number of times the last ACQuire:STReam? dropped samples
+ * because the USB link could not keep up.
+ *
+ * \param context   Active SCPI context
+ * \return  Success or failure
+ */
+scpi_result_t ACQ_STREAM_OVERRUNS_Q(scpi_t *context)
+{
+    SCPI_ResultInt(context, G_STREAM_OVERRUNS);
+    return SCPI_RES_OK;
+}
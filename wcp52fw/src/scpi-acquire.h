@@ -0,0 +1,28 @@
+/**
+ * \file
+ * SCPI ACQuire:* commands
+ */
+
+#ifndef _SCPI_ACQUIRE_H
+#define _SCPI_ACQUIRE_H 1
+
+#include "scpi/scpi.h"
+
+scpi_result_t ACQ_SRATE (scpi_t *context);
+scpi_result_t ACQ_SRATE_Q (scpi_t *context);
+scpi_result_t ACQ_STATS_Q (scpi_t *context);
+scpi_result_t ACQ_SETTLE (scpi_t *context);
+scpi_result_t ACQ_SETTLE_Q (scpi_t *context);
+scpi_result_t ACQ_SETTLE_TIME_Q (scpi_t *context);
+scpi_result_t ACQ_AVERAGE_Q (scpi_t *context);
+scpi_result_t ACQ_DECIMATE (scpi_t *context);
+scpi_result_t ACQ_DECIMATE_Q (scpi_t *context);
+scpi_result_t ACQ_HIRES_STATS_Q (scpi_t *context);
+scpi_result_t ACQ_TONE_Q (scpi_t *context);
+scpi_result_t ACQ_LOCKIN_Q (scpi_t *context);
+scpi_result_t ACQ_DUAL_STATS_Q (scpi_t *context);
+scpi_result_t ACQ_DUAL_TONE_Q (scpi_t *context);
+scpi_result_t ACQ_STREAM_Q (scpi_t *context);
+scpi_result_t ACQ_STREAM_OVERRUNS_Q (scpi_t *context);
+
+#endif // _SCPI_ACQUIRE_H
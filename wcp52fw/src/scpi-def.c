@@ -41,6 +41,8 @@
 #include "scpi-def.h"
 #include "scpi-test.h"
 #include "scpi-lowlevel.h"
+#include "scpi-acquire.h"
+#include "scpi-sweep.h"
 
 static const scpi_command_t scpi_commands[] = {
     /* IEEE Mandated Commands (SCPI std V1999.0 4.1.1) */
@@ -84,13 +86,57 @@ static const scpi_command_t scpi_commands[] = {
 
     /* Test commands */
     {.pattern = "Test:SPI", .callback = TEST_SPI,},
+    {.pattern = "Test:SPI:CLOCk", .callback = TEST_SPI_CLOCK,},
+    {.pattern = "Test:DUMP?", .callback = TEST_DUMP_Q,},
+    {.pattern = "Test:VERify", .callback = TEST_VERIFY,},
+    {.pattern = "Test:RESYnc", .callback = TEST_RESYNC,},
+    {.pattern = "Test:RESYnc:COUNt?", .callback = TEST_RESYNC_COUNT_Q,},
     {.pattern = "Test:INIF", .callback = TEST_INIF,}, /* Init interface */
     {.pattern = "Test:INCK", .callback = TEST_INCK,}, /* Init clock */
+    {.pattern = "Test:BEGin", .callback = TEST_BEGIN,},
+    {.pattern = "Test:COMMit", .callback = TEST_COMMIT,},
     {.pattern = "Test:FREQ", .callback = TEST_FREQ,},
     {.pattern = "Test:PHASE", .callback = TEST_PHASE,},
     {.pattern = "Test:AMPlitude", .callback = TEST_AMPLITUDE,},
+    {.pattern = "Test:AMPlitude:RAMP", .callback = TEST_AMPLITUDE_RAMP,},
+    {.pattern = "Test:COHerent", .callback = TEST_COHERENT,},
     {.pattern = "Test:SAMple", .callback = TEST_SAMPLE,},
     {.pattern = "Test:CHannel", .callback = TEST_CHANNEL,},
+
+    /* Acquisition */
+    {.pattern = "ACQuire:SRATe", .callback = ACQ_SRATE,},
+    {.pattern = "ACQuire:SRATe?", .callback = ACQ_SRATE_Q,},
+    {.pattern = "ACQuire:STATistics?", .callback = ACQ_STATS_Q,},
+    {.pattern = "ACQuire:SETtle", .callback = ACQ_SETTLE,},
+    {.pattern = "ACQuire:SETtle?", .callback = ACQ_SETTLE_Q,},
+    {.pattern = "ACQuire:SETtle:TIME?", .callback = ACQ_SETTLE_TIME_Q,},
+    {.pattern = "ACQuire:AVERage?", .callback = ACQ_AVERAGE_Q,},
+    {.pattern = "ACQuire:DECimate", .callback = ACQ_DECIMATE,},
+    {.pattern = "ACQuire:DECimate?", .callback = ACQ_DECIMATE_Q,},
+    {.pattern = "ACQuire:HIRes:STATistics?", .callback = ACQ_HIRES_STATS_Q,},
+    {.pattern = "ACQuire:TONE?", .callback = ACQ_TONE_Q,},
+    {.pattern = "ACQuire:LOCKin?", .callback = ACQ_LOCKIN_Q,},
+    {.pattern = "ACQuire:DUAL:STATistics?", .callback = ACQ_DUAL_STATS_Q,},
+    {.pattern = "ACQuire:DUAL:TONE?", .callback = ACQ_DUAL_TONE_Q,},
+    {.pattern = "ACQuire:STReam?", .callback = ACQ_STREAM_Q,},
+    {.pattern = "ACQuire:STReam:OVERruns?", .callback = ACQ_STREAM_OVERRUNS_Q,},
+
+    /* Sweep */
+    {.pattern = "SWEep:STARt", .callback = SWEEP_START,},
+    {.pattern = "SWEep:STARt?", .callback = SWEEP_START_Q,},
+    {.pattern = "SWEep:STOP", .callback = SWEEP_STOP,},
+    {.pattern = "SWEep:STOP?", .callback = SWEEP_STOP_Q,},
+    {.pattern = "SWEep:POINts", .callback = SWEEP_POINTS,},
+    {.pattern = "SWEep:POINts?", .callback = SWEEP_POINTS_Q,},
+    {.pattern = "SWEep:SPACing", .callback = SWEEP_SPACING,},
+    {.pattern = "SWEep:SPACing?", .callback = SWEEP_SPACING_Q,},
+    {.pattern = "SWEep:DWELl", .callback = SWEEP_DWELL,},
+    {.pattern = "SWEep:DWELl?", .callback = SWEEP_DWELL_Q,},
+    {.pattern = "SWEep:MEASure", .callback = SWEEP_MEASURE,},
+    {.pattern = "SWEep:MEASure?", .callback = SWEEP_MEASURE_Q,},
+    {.pattern = "SWEep:DATA?", .callback = SWEEP_DATA_Q,},
+    {.pattern = "SWEep:COUNt?", .callback = SWEEP_COUNT_Q,},
+    {.pattern = "INITiate[:IMMediate]", .callback = SWEEP_INITIATE,},
     SCPI_CMD_LIST_END
 };
 
@@ -106,6 +152,12 @@ static scpi_interface_t scpi_interface = {
 #define SCPI_INPUT_BUFFER_LENGTH 256
 static char scpi_input_buffer[SCPI_INPUT_BUFFER_LENGTH];
 static scpi_reg_val_t scpi_regs[SCPI_REG_COUNT];
+
+// Keyword tree built from scpi_commands by SCPI_Init; one node per distinct
+// keyword path, about one per command
+#define SCPI_INDEX_LENGTH 128
+static scpi_command_node_t scpi_index_nodes[SCPI_INDEX_LENGTH];
+
 scpi_t G_SCPI_CONTEXT = {
     .cmdlist = scpi_commands,
     .buffer = {
@@ -117,4 +169,8 @@ scpi_t G_SCPI_CONTEXT = {
     .units = scpi_units_def,
     .special_numbers = scpi_special_numbers_def,
     .idn = {"WCP52", "GPA1", "1", "0"},
+    .cmdindex = {
+        .nodes = scpi_index_nodes,
+        .length = SCPI_INDEX_LENGTH,
+    },
 };
@@ -0,0 +1,384 @@
+/**
+ * \file
+ * \brief SCPI SWEep:* and INITiate commands
+ */
+
+// Atmel ASF includes
+#include <udi_cdc.h>
+
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include "scpi/scpi.h"
+#include "scpi-def.h"
+#include "scpi-sweep.h"
+#include "sweep.h"
+#include "usb-functions.h"
+
+static const char *SPACINGS[] = {"LINear", "LOGarithmic", NULL};
+static const char *MEASURES[] = {"TONE", "DUAL", NULL};
+
+/**
+ * Apply changed sweep settings, reporting any that are out of range.
+ */
+static scpi_result_t configure(scpi_t *context, const struct sweep_config *cfg)
+{
+    if (!sweep_configure(cfg)) {
+        SCPI_ErrorPush(context, SCPI_ERROR_ILLEGAL_PARAMETER_VALUE);
+        return SCPI_RES_ERR;
+    }
+    return SCPI_RES_OK;
+}
+
+/**
+ * SCPI: Set the first frequency of the sweep.
+ * SWEep:STARt freq
+ *
+ * \param context   Active SCPI context
+ * \return  Success or failure
+ */
+scpi_result_t SWEEP_START(scpi_t *context)
+{
+    struct sweep_config cfg;
+    scpi_number_t freq;
+
+    if (!SCPI_ParamNumber(context, &freq, true)) {
+        return SCPI_RES_ERR;
+    }
+
+    sweep_get_config(&cfg);
+    cfg.start = freq.value;
+    return configure(context, &cfg);
+}
+
+/**
+ * SCPI: Query the first frequency of the sweep.
+ * SWEep:STARt?
+ *
+ * \param context   Active SCPI context
+ * \return  Success or failure
+ */
+scpi_result_t SWEEP_START_Q(scpi_t *context)
+{
+    struct sweep_config cfg;
+
+    sweep_get_config(&cfg);
+    SCPI_ResultDouble(context, cfg.start);
+    return SCPI_RES_OK;
+}
+
+/**
+ * SCPI: Set the last frequency of the sweep. It may be below the first.
+ * SWEep:STOP freq
+ *
+ * \param context   Active SCPI context
+ * \return  Success or failure
+ */
+scpi_result_t SWEEP_STOP(scpi_t *context)
+{
+    struct sweep_config cfg;
+    scpi_number_t freq;
+
+    if (!SCPI_ParamNumber(context, &freq, true)) {
+        return SCPI_RES_ERR;
+    }
+
+    sweep_get_config(&cfg);
+    cfg.stop = freq.value;
+    return configure(context, &cfg);
+}
+
+/**
+ * SCPI: Query the last frequency of the sweep.
+ * SWEep:STOP?
+ *
+ * \param context   Active SCPI context
+ * \return  Success or failure
+ */
+scpi_result_t SWEEP_STOP_Q(scpi_t *context)
+{
+    struct sweep_config cfg;
+
+    sweep_get_config(&cfg);
+    SCPI_ResultDouble(context, cfg.stop);
+    return SCPI_RES_OK;
+}
+
+/**
+ * SCPI: Set the number of sweep points, 1 to SWEEP_POINTS_MAX.
+ * SWEep:POINts count
+ *
+ * \param context   Active SCPI context
+ * \return  Success or failure
+ */
+scpi_result_t SWEEP_POINTS(scpi_t *context)
+{
+    struct sweep_config cfg;
+    int32_t points;
+
+    if (!SCPI_ParamInt(context, &points, true)) {
+        return SCPI_RES_ERR;
+    }
+
+    if (points < 1) {
+        SCPI_ErrorPush(context, SCPI_ERROR_ILLEGAL_PARAMETER_VALUE);
+        return SCPI_RES_ERR;
+    }
+
+    sweep_get_config(&cfg);
+    cfg.points = points;
+    return configure(context, &cfg);
+}
+
+/**
+ * SCPI: Query the number of sweep points.
+ * SWEep:POINts?
+ *
+ * \param context   Active SCPI context
+ * \return  Success or failure
+ */
+scpi_result_t SWEEP_POINTS_Q(scpi_t *context)
+{
+    struct sweep_config cfg;
+
+    sweep_get_config(&cfg);
+    SCPI_ResultInt(context, cfg.points);
+    return SCPI_RES_OK;
+}
+
+/**
+ * SCPI: Set the spacing of the sweep points.
+ * SWEep:SPACing LINear|LOGarithmic
+ *
+ * Logarithmic spacing needs both frequencies above zero.
+ *
+ * \param context   Active SCPI context
+ * \return  Success or failure
+ */
+scpi_result_t SWEEP_SPACING(scpi_t *context)
+{
+    struct sweep_config cfg;
+    int32_t spacing;
+
+    if (!SCPI_ParamChoice(context, SPACINGS, &spacing, true)) {
+        return SCPI_RES_ERR;
+    }
+
+    sweep_get_config(&cfg);
+    cfg.spacing = spacing ? SWEEP_LOG : SWEEP_LINEAR;
+    return configure(context, &cfg);
+}
+
+/**
+ * SCPI: Query the spacing of the sweep points.
+ * SWEep:SPACing?
+ *
+ * \param context   Active SCPI context
+ * \return  Success or failure
+ */
+scpi_result_t SWEEP_SPACING_Q(scpi_t *context)
+{
+    struct sweep_config cfg;
+
+    sweep_get_config(&cfg);
+    SCPI_ResultString(context, cfg.spacing == SWEEP_LOG ? "LOG" : "LIN");
+    return SCPI_RES_OK;
+}
+
+/**
+ * SCPI: Set how long each point is measured.
+ * SWEep:DWELl samples[, cycles]
+ *
+ * Each point takes at least the given number of samples, and, if cycles is
+ * given, enough samples to cover that many periods of the stimulus. Low
+ * frequencies then get longer acquisitions without slowing the whole sweep.
+ *
+ * \param context   Active SCPI context
+ * \return  Success or failure
+ */
+scpi_result_t SWEEP_DWELL(scpi_t *context)
+{
+    struct sweep_config cfg;
+    int32_t samples;
+    double cycles = 0.0;
+
+    if (!SCPI_ParamInt(context, &samples, true)) {
+        return SCPI_RES_ERR;
+    }
+
+    if (!SCPI_ParamDouble(context, &cycles, false) && context->cmd_error) {
+        return SCPI_RES_ERR;
+    }
+
+    if (samples < 1) {
+        SCPI_ErrorPush(context, SCPI_ERROR_ILLEGAL_PARAMETER_VALUE);
+        return SCPI_RES_ERR;
+    }
+
+    sweep_get_config(&cfg);
+    cfg.dwell = samples;
+    cfg.dwell_cycles = cycles;
+    return configure(context, &cfg);
+}
+
+/**
+ * SCPI: Query how long each point is measured.
+ * SWEep:DWELl?
+ *
+ * Returns the least number of samples and of stimulus periods.
+ *
+ * \param context   Active SCPI context
+ * \return  Success or failure
+ */
+scpi_result_t SWEEP_DWELL_Q(scpi_t *context)
+{
+    struct sweep_config cfg;
+
+    sweep_get_config(&cfg);
+    SCPI_ResultInt(context, cfg.dwell);
+    SCPI_ResultDouble(context, cfg.dwell_cycles);
+    return SCPI_RES_OK;
+}
+
+/**
+ * SCPI: Set the measurement taken at each point.
+ * SWEep:MEASure TONE|DUAL
+ *
+ * DUAL, the default, measures gain and phase of the DUT input against the
+ * reference, as ACQuire:DUAL:TONE?. TONE measures only the amplitude on the
+ * DUT input, as ACQuire:TONE?, and allows twice the sample rate.
+ *
+ * \param context   Active SCPI context
+ * \return  Success or failure
+ */
+scpi_result_t SWEEP_MEASURE(scpi_t *context)
+{
+    struct sweep_config cfg;
+    int32_t measure;
+
+    if (!SCPI_ParamChoice(context, MEASURES, &measure, true)) {
+        return SCPI_RES_ERR;
+    }
+
+    sweep_get_config(&cfg);
+    cfg.measure = measure ? SWEEP_DUAL : SWEEP_TONE;
+    return configure(context, &cfg);
+}
+
+/**
+ * SCPI: Query the measurement taken at each point.
+ * SWEep:MEASure?
+ *
+ * \param context   Active SCPI context
+ * \return  Success or failure
+ */
+scpi_result_t SWEEP_MEASURE_Q(scpi_t *context)
+{
+    struct sweep_config cfg;
+
+    sweep_get_config(&cfg);
+    SCPI_ResultString(context, cfg.measure == SWEEP_DUAL ? "DUAL" : "TONE");
+    return SCPI_RES_OK;
+}
+
+/**
+ * SCPI: Fetch the results of the last sweep.
+ * SWEep:DATA?
+ *
+ * Sends an IEEE 488.2 definite-length block holding one record per point:
+ * frequency in Hz, gain and phase in degrees for a DUAL sweep, or frequency
+ * in Hz and amplitude in ADC counts for a TONE sweep. Each value is a
+ * little-endian 32-bit float. Failed points hold NaN. If the link goes down,
+ * the block is cut short and an execution error is queued.
+ *
+ * \param context   Active SCPI context
+ * \return  Success or failure
+ */
+scpi_result_t SWEEP_DATA_Q(scpi_t *context)
+{
+    unsigned count;
+    enum sweep_measure measure;
+    const struct sweep_result *results = sweep_get_results(&count, &measure);
+    char header[16];
+
+    if (!G_CDC_ENABLED) {
+        SCPI_ErrorPush(context, SCPI_ERROR_EXECUTION_ERROR);
+        return SCPI_RES_ERR;
+    }
+
+    // Anything already printed must go out ahead of the block
+    fflush(stdout);
+    SCPI_Flush(context);
+
+    // TONE records stop short of the phase
+    size_t record = sizeof(*results);
+    if (measure == SWEEP_TONE) {
+        record = offsetof(struct sweep_result, phase);
+    }
+
+    unsigned long len = (unsigned long) count * record;
+    int digits = snprintf(header, sizeof(header), "%lu", len);
+    snprintf(header, sizeof(header), "#%d%lu", digits, len);
+    if (udi_cdc_write_buf(header, strlen(header))) {
+        SCPI_ErrorPush(context, SCPI_ERROR_EXECUTION_ERROR);
+        return SCPI_RES_ERR;
+    }
+
+    // A short block can't be repaired once its length is sent; the error
+    // tells the host not to trust it
+    bool sent;
+    if (record == sizeof(*results)) {
+        sent = !udi_cdc_write_buf(results, len);
+    } else {
+        sent = true;
+        for (unsigned i = 0; i < count && sent; ++i) {
+            sent = !udi_cdc_write_buf(&results[i], record);
+        }
+    }
+
+    if (!sent || udi_cdc_write_buf("\r\n", 2)) {
+        SCPI_ErrorPush(context, SCPI_ERROR_EXECUTION_ERROR);
+        return SCPI_RES_ERR;
+    }
+    return SCPI_RES_OK;
+}
+
+/**
+ * SCPI: Query the progress of the last sweep.
+ * SWEep:COUNt?
+ *
+ * Returns the number of points measured and the number that failed.
+ *
+ * \param context   Active SCPI context
+ * \return  Success or failure
+ */
+scpi_result_t SWEEP_COUNT_Q(scpi_t *context)
+{
+    unsigned count;
+
+    sweep_get_results(&count, NULL);
+    SCPI_ResultInt(context, count);
+    SCPI_ResultInt(context, sweep_get_failures());
+    return SCPI_RES_OK;
+}
+
+/**
+ * SCPI: Run the configured sweep.
+ * INITiate[:IMMediate]
+ *
+ * Retunes, settles and measures at every point without host involvement;
+ * fetch the results with SWEep:DATA?. Needs a sample rate set with
+ * ACQuire:SRATe, no more than half the highest rate for DUAL measurements.
+ * Settling before each point is set by ACQuire:SETtle.
+ *
+ * \param context   Active SCPI context
+ * \return  Success or failure
+ */
+scpi_result_t SWEEP_INITIATE(scpi_t *context)
+{
+    if (!sweep_run()) {
+        SCPI_ErrorPush(context, SCPI_ERROR_EXECUTION_ERROR);
+        return SCPI_RES_ERR;
+    }
+    return SCPI_RES_OK;
+}
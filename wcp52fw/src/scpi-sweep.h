@@ -0,0 +1,27 @@
+/**
+ * \file
+ * SCPI SWEep:* and INITiate commands
+ */
+
+#ifndef _SCPI_SWEEP_H
+#define _SCPI_SWEEP_H 1
+
+#include "scpi/scpi.h"
+
+scpi_result_t SWEEP_START (scpi_t *context);
+scpi_result_t SWEEP_START_Q (scpi_t *context);
+scpi_result_t SWEEP_STOP (scpi_t *context);
+scpi_result_t SWEEP_STOP_Q (scpi_t *context);
+scpi_result_t SWEEP_POINTS (scpi_t *context);
+scpi_result_t SWEEP_POINTS_Q (scpi_t *context);
+scpi_result_t SWEEP_SPACING (scpi_t *context);
+scpi_result_t SWEEP_SPACING_Q (scpi_t *context);
+scpi_result_t SWEEP_DWELL (scpi_t *context);
+scpi_result_t SWEEP_DWELL_Q (scpi_t *context);
+scpi_result_t SWEEP_MEASURE (scpi_t *context);
+scpi_result_t SWEEP_MEASURE_Q (scpi_t *context);
+scpi_result_t SWEEP_DATA_Q (scpi_t *context);
+scpi_result_t SWEEP_COUNT_Q (scpi_t *context);
+scpi_result_t SWEEP_INITIATE (scpi_t *context);
+
+#endif // _SCPI_SWEEP_H
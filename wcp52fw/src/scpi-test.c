@@ -6,6 +6,9 @@
 // Atmel ASF includes
 #include <pio.h>
 #include <spi.h>
+#include <sysclk.h>
+
+#include <math.h>
 
 #include "scpi/scpi.h"
 #include "scpi-test.h"
@@ -33,6 +36,111 @@ scpi_result_t TEST_SPI(scpi_t *context)
     return SCPI_RES_OK;   
 }
 
+/**
+ * SCPI: Set the DDS SPI clock
+ * Test:SPI:CLOCk frequency
+ *
+ * The clock is set to the highest rate the SPI divider allows that does not
+ * exceed the given frequency. The frequency must be from 1 Hz up to the
+ * peripheral clock, the fastest the SPI can run.
+ *
+ * \param context   Active SCPI context
+ * \return  Success or failure
+ */
+scpi_result_t TEST_SPI_CLOCK(scpi_t *context)
+{
+    scpi_number_t freq;
+
+    if (!SCPI_ParamNumber(context, &freq, true)) {
+        return SCPI_RES_ERR;
+    }
+
+    // The SPI divider is at least 1, so the clock cannot exceed MCK
+    if (!(freq.value >= 1.0 && freq.value <= sysclk_get_peripheral_hz())) {
+        SCPI_ErrorPush(context, SCPI_ERROR_ILLEGAL_PARAMETER_VALUE);
+        return SCPI_RES_ERR;
+    }
+
+    uint32_t actual = synth_set_spi_clock((uint32_t) freq.value);
+    printf("SPI clock set to %lu Hz\r\n", (unsigned long) actual);
+    return SCPI_RES_OK;
+}
+
+/**
+ * SCPI: Read back the DDS register file
+ * Test:DUMP?
+ *
+ * Returns, for CSR and then each register in turn, its name and its
+ * contents as read from the device, as an unquoted #H hex number.
+ *
+ * \param context   Active SCPI context
+ * \return  Success or failure
+ */
+scpi_result_t TEST_DUMP_Q(scpi_t *context)
+{
+    bool put_register (const char *name, const uint8_t *data, size_t len) {
+        uint32_t value = 0;
+        for (size_t i = 0; i < len; ++i) {
+            value = (value << 8) | data[i];
+        }
+        SCPI_ResultString(context, name);
+        SCPI_ResultUInt32Base(context, value, 16);
+        return true;
+    }
+
+    synth_dump(&put_register);
+    return SCPI_RES_OK;
+}
+
+/**
+ * SCPI: Enable or disable verify-after-write on the DDS
+ * Test:VERify ON|OFF
+ *
+ * \param context   Active SCPI context
+ * \return  Success or failure
+ */
+scpi_result_t TEST_VERIFY(scpi_t *context)
+{
+    scpi_bool_t verify;
+
+    if (!SCPI_ParamBool(context, &verify, true)) {
+        return SCPI_RES_ERR;
+    }
+
+    synth_set_verify(verify);
+    return SCPI_RES_OK;
+}
+
+/**
+ * SCPI: Resynchronise the DDS interface and rewrite all registers
+ * Test:RESYnc
+ *
+ * Fails if the registers still do not read back correctly.
+ *
+ * \param context   Active SCPI context
+ * \return  Success or failure
+ */
+scpi_result_t TEST_RESYNC(scpi_t *context)
+{
+    (void) context;
+    return synth_resync() ? SCPI_RES_OK : SCPI_RES_ERR;
+}
+
+/**
+ * SCPI: Count automatic DDS resyncs
+ * Test:RESYnc:COUNt?
+ *
+ * Returns how many times verify-after-write found a mismatch.
+ *
+ * \param context   Active SCPI context
+ * \return  Success or failure
+ */
+scpi_result_t TEST_RESYNC_COUNT_Q(scpi_t *context)
+{
+    SCPI_ResultInt(context, synth_get_resync_count());
+    return SCPI_RES_OK;
+}
+
 /**
  * SCPI: Initialize DDS interface
  * Test:INIF
@@ -61,6 +169,109 @@ scpi_result_t TEST_INCK(scpi_t *context)
     return SCPI_RES_OK;   
 }
 
+/**
+ * SCPI: Ramp the DDS amplitude to a new value
+ * Test:AMPlitude:RAMP channel, amplitude, seconds
+ *
+ * The amplitude is stepped from its current value by the ramp timer
+ * interrupt over about the given time, up to SYNTH_RAMP_MAX_MS; the command
+ * returns at once. A time of 0 changes the amplitude in one step.
+ *
+ * \param context   Active SCPI context
+ * \return  Success or failure
+ */
+scpi_result_t TEST_AMPLITUDE_RAMP(scpi_t *context)
+{
+    int32_t ch;
+    double amplitude, seconds;
+
+    if (!SCPI_ParamInt(context, &ch, true)) {
+        return SCPI_RES_ERR;
+    }
+
+    if (!SCPI_ParamDouble(context, &amplitude, true)
+            || !SCPI_ParamDouble(context, &seconds, true)) {
+        return SCPI_RES_ERR;
+    }
+
+    if (ch < 0 || ch > 1 || !(amplitude >= 0.0 && amplitude <= 1.0)
+            || !(seconds >= 0.0 && seconds <= SYNTH_RAMP_MAX_MS / 1e3)) {
+        SCPI_ErrorPush(context, SCPI_ERROR_ILLEGAL_PARAMETER_VALUE);
+        return SCPI_RES_ERR;
+    }
+
+    synth_ramp_asf(ch, synth_amplitude_to_asf(lround(amplitude * 1e6)),
+            seconds);
+    return SCPI_RES_OK;
+}
+
+/**
+ * SCPI: Set frequency and phase on both DDS channels at once
+ * Test:COHerent freq0, phase0, freq1, phase1
+ *
+ * Both channels change under one IO_UPDATE with their phase accumulators
+ * cleared together, so the phase offset between them is exactly
+ * phase1 - phase0. Amplitudes are left as they are.
+ *
+ * \param context   Active SCPI context
+ * \return  Success or failure
+ */
+scpi_result_t TEST_COHERENT(scpi_t *context)
+{
+    double freq[2], phase[2];
+    struct synth_point pt[2];
+
+    for (unsigned ch = 0; ch < 2; ++ch) {
+        if (!SCPI_ParamDouble(context, &freq[ch], true)
+                || !SCPI_ParamDouble(context, &phase[ch], true)) {
+            return SCPI_RES_ERR;
+        }
+
+        if (freq[ch] < 0.0 || freq[ch] >= SYSCLK_FREQ / 2) {
+            SCPI_ErrorPush(context, SCPI_ERROR_ILLEGAL_PARAMETER_VALUE);
+            return SCPI_RES_ERR;
+        }
+    }
+
+    for (unsigned ch = 0; ch < 2; ++ch) {
+        synth_get_point(ch, &pt[ch]);
+        pt[ch].ftw = synth_freq_to_ftw(llround(freq[ch] * 1000.));
+        pt[ch].pow = synth_phase_to_pow(lround(fmod(phase[ch], 360.) * 1000.));
+    }
+
+    synth_load_both(&pt[0], &pt[1]);
+    return SCPI_RES_OK;
+}
+
+/**
+ * SCPI: Start a DDS transaction. DDS settings made until Test:COMMit are
+ * queued and take effect together.
+ * Test:BEGin
+ *
+ * \param context   Active SCPI context
+ * \return  Success or failure
+ */
+scpi_result_t TEST_BEGIN(scpi_t *context)
+{
+    (void) context;
+    synth_begin();
+    return SCPI_RES_OK;
+}
+
+/**
+ * SCPI: Commit a DDS transaction
+ * Test:COMMit
+ *
+ * \param context   Active SCPI context
+ * \return  Success or failure
+ */
+scpi_result_t TEST_COMMIT(scpi_t *context)
+{
+    (void) context;
+    synth_commit();
+    return SCPI_RES_OK;
+}
+
 /**
  * SCPI: Set DDS frequency
  * Test:FREQ channel, frequency
@@ -10,11 +10,20 @@
 
 scpi_result_t TEST_SETCLR (scpi_t *context);
 scpi_result_t TEST_SPI (scpi_t *context);
+scpi_result_t TEST_SPI_CLOCK (scpi_t *context);
+scpi_result_t TEST_DUMP_Q (scpi_t *context);
+scpi_result_t TEST_VERIFY (scpi_t *context);
+scpi_result_t TEST_RESYNC (scpi_t *context);
+scpi_result_t TEST_RESYNC_COUNT_Q (scpi_t *context);
 scpi_result_t TEST_INIF (scpi_t *context);
 scpi_result_t TEST_INCK (scpi_t *context);
+scpi_result_t TEST_BEGIN (scpi_t *context);
+scpi_result_t TEST_COMMIT (scpi_t *context);
 scpi_result_t TEST_FREQ (scpi_t *context);
 scpi_result_t TEST_PHASE (scpi_t *context);
 scpi_result_t TEST_AMPLITUDE (scpi_t *context);
+scpi_result_t TEST_AMPLITUDE_RAMP (scpi_t *context);
+scpi_result_t TEST_COHERENT (scpi_t *context);
 scpi_result_t TEST_SAMPLE (scpi_t *context);
 scpi_result_t TEST_CHANNEL (scpi_t *context);
 
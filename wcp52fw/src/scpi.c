@@ -1,15 +1,36 @@
 // Atmel ASF includes
 #include <pmc.h>
+#include <udi_cdc.h>
 
 #include <stdio.h>
+#include <string.h>
 #include <inttypes.h>
 #include "scpi/scpi.h"
 #include "scpi-def.h"
+#include "usb-functions.h"
 
 /* These functions are required by the SCPI library to interact with the
  * console.
  */
 
+/**
+ * Responses are gathered here and sent to the host a full USB packet at a
+ * time, or when the parser flushes at the end of a response line.
+ */
+static char G_OUTPUT[UDI_CDC_DATA_EPS_FS_SIZE];
+static size_t G_OUTPUT_LEN = 0;
+
+/**
+ * Send the gathered output. It is dropped if no host has the port open.
+ */
+static void output_push(void)
+{
+    if (G_OUTPUT_LEN && G_CDC_ENABLED) {
+        udi_cdc_write_buf(G_OUTPUT, G_OUTPUT_LEN);
+    }
+    G_OUTPUT_LEN = 0;
+}
+
 /**
  * Write back to the SCPI console.
  * \param context   Active SCPI context
@@ -19,16 +40,32 @@
  */
 size_t SCPI_Write(scpi_t *context, const char * data, size_t len) {
     (void) context;
-    return fwrite (data, 1, len, stdout);
+
+    for (size_t i = 0; i < len;) {
+        if (G_OUTPUT_LEN == sizeof(G_OUTPUT)) {
+            output_push();
+        }
+
+        size_t n = sizeof(G_OUTPUT) - G_OUTPUT_LEN;
+        if (n > len - i) {
+            n = len - i;
+        }
+        memcpy(&G_OUTPUT[G_OUTPUT_LEN], &data[i], n);
+        G_OUTPUT_LEN += n;
+        i += n;
+    }
+    return len;
 }
 
 /**
- * Flush the SCPI console. May be a no-op if not possible or sensible.
+ * Send any buffered SCPI console output to the host now.
  * \param context   Active SCPI context
- * \return  Success or failure; returns success on no-op.
+ * \return  Always success; there is nothing to report if the link is
+ *          down and the output is dropped.
  */
 scpi_result_t SCPI_Flush (scpi_t *context) {
     (void) context;
+    output_push();
     return SCPI_RES_OK;
 }
 
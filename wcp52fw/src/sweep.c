@@ -0,0 +1,168 @@
+/**
+ * \file
+ * Frequency sweeps run entirely on the device
+ */
+
+#include <math.h>
+
+#include "acquisition.h"
+#include "synth.h"
+#include "sweep.h"
+
+/**
+ * One planned point: everything needed to retune and acquire, with no
+ * arithmetic left to do.
+ */
+struct sweep_step {
+    uint32_t ftw;       ///< Frequency tuning word
+    uint32_t dwell;     ///< Samples to take
+};
+
+static struct sweep_config G_CONFIG = {
+    .start = 1000.0,
+    .stop = 100000.0,
+    .points = 101,
+    .spacing = SWEEP_LOG,
+    .dwell = 1024,
+    .dwell_cycles = 0.0,
+    .measure = SWEEP_DUAL,
+};
+
+static struct sweep_step G_PLAN[SWEEP_POINTS_MAX];
+static struct sweep_result G_RESULTS[SWEEP_POINTS_MAX];
+
+// Set while G_PLAN matches G_CONFIG at sample rate G_PLAN_SRATE
+static bool G_PLAN_VALID = false;
+static double G_PLAN_SRATE = 0.0;
+
+static unsigned G_RESULT_COUNT = 0;
+static enum sweep_measure G_RESULT_MEASURE = SWEEP_DUAL;
+static unsigned G_FAILURES = 0;
+
+bool sweep_configure(const struct sweep_config *cfg)
+{
+    if (cfg->points < 1 || cfg->points > SWEEP_POINTS_MAX
+            || cfg->start < 0.0 || cfg->start >= SYSCLK_FREQ / 2
+            || cfg->stop < 0.0 || cfg->stop >= SYSCLK_FREQ / 2
+            || (cfg->spacing == SWEEP_LOG && (cfg->start <= 0.0 || cfg->stop <= 0.0))
+            || cfg->dwell < 1 || cfg->dwell > SWEEP_DWELL_MAX
+            || cfg->dwell_cycles < 0.0) {
+        return false;
+    }
+
+    G_CONFIG = *cfg;
+    G_PLAN_VALID = false;
+    return true;
+}
+
+void sweep_get_config(struct sweep_config *cfg)
+{
+    *cfg = G_CONFIG;
+}
+
+/**
+ * Fill the plan from the settings.
+ * \param srate     Sample rate the dwell counts are worked out for
+ */
+static void build_plan(double srate)
+{
+    const struct sweep_config *cfg = &G_CONFIG;
+    unsigned intervals = cfg->points > 1 ? cfg->points - 1 : 1;
+    double step;
+
+    if (cfg->spacing == SWEEP_LOG) {
+        step = pow(cfg->stop / cfg->start, 1.0 / intervals);
+    } else {
+        step = (cfg->stop - cfg->start) / intervals;
+    }
+
+    for (unsigned i = 0; i < cfg->points; ++i) {
+        struct sweep_step *s = &G_PLAN[i];
+        double freq;
+
+        if (cfg->spacing == SWEEP_LOG) {
+            freq = cfg->start * pow(step, i);
+        } else {
+            freq = cfg->start + step * i;
+        }
+
+        s->ftw = synth_freq_to_ftw((uint64_t) (freq * 1000.0 + 0.5));
+
+        // Enough samples to cover the requested number of periods
+        double dwell = cfg->dwell;
+        if (cfg->dwell_cycles > 0.0 && freq > 0.0) {
+            dwell = fmax(dwell, ceil(cfg->dwell_cycles * srate / freq));
+        }
+        s->dwell = dwell < SWEEP_DWELL_MAX ? dwell : SWEEP_DWELL_MAX;
+    }
+
+    G_PLAN_SRATE = srate;
+    G_PLAN_VALID = true;
+}
+
+bool sweep_run(void)
+{
+    const struct sweep_config *cfg = &G_CONFIG;
+    double srate = acq_get_sample_rate();
+
+    G_RESULT_COUNT = 0;
+    G_RESULT_MEASURE = cfg->measure;
+    G_FAILURES = 0;
+
+    if (srate <= 0.0) {
+        return false;
+    }
+
+    // Dual captures convert both inputs on every trigger
+    if (cfg->measure == SWEEP_DUAL && srate > acq_get_sample_rate_max(2)) {
+        return false;
+    }
+
+    if (!G_PLAN_VALID || G_PLAN_SRATE != srate) {
+        build_plan(srate);
+    }
+
+    for (unsigned i = 0; i < cfg->points; ++i) {
+        const struct sweep_step *s = &G_PLAN[i];
+        struct sweep_result *r = &G_RESULTS[i];
+        double freq = s->ftw * ((double) SYSCLK_FREQ / 4294967296.);
+        double magnitude, phase = NAN;
+        bool ok;
+
+        synth_set_ftw(0, s->ftw);
+
+        if (cfg->measure == SWEEP_DUAL) {
+            ok = acq_get_dual_tone(freq, s->dwell, &magnitude, &phase);
+        } else {
+            ok = acq_get_tone(freq, s->dwell, &magnitude);
+        }
+
+        r->freq = freq;
+        if (ok) {
+            r->magnitude = magnitude;
+            r->phase = phase;
+        } else {
+            r->magnitude = NAN;
+            r->phase = NAN;
+            ++G_FAILURES;
+        }
+        G_RESULT_COUNT = i + 1;
+    }
+
+    return G_FAILURES == 0;
+}
+
+const struct sweep_result *sweep_get_results(unsigned *count,
+        enum sweep_measure *measure)
+{
+    *count = G_RESULT_COUNT;
+    if (measure) {
+        *measure = G_RESULT_MEASURE;
+    }
+    return G_RESULTS;
+}
+
+unsigned sweep_get_failures(void)
+{
+    return G_FAILURES;
+}
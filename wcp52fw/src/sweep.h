@@ -0,0 +1,99 @@
+/**
+ * \file
+ * Frequency sweeps run entirely on the device
+ */
+
+#ifndef _WCP52_SWEEP_H
+#define _WCP52_SWEEP_H 1
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * Most points in one sweep. The plan and results for every point are kept in
+ * RAM.
+ */
+#define SWEEP_POINTS_MAX 512
+
+/**
+ * Most samples taken at one point.
+ */
+#define SWEEP_DWELL_MAX 1000000uL
+
+/**
+ * Spacing of sweep points between the start and stop frequencies.
+ */
+enum sweep_spacing {
+    SWEEP_LINEAR,
+    SWEEP_LOG,
+};
+
+/**
+ * Measurement taken at each point.
+ */
+enum sweep_measure {
+    SWEEP_TONE,     ///< Amplitude of the DUT input, as acq_get_tone
+    SWEEP_DUAL,     ///< Gain and phase of DUT over reference, as acq_get_dual_tone
+};
+
+/**
+ * Sweep settings.
+ */
+struct sweep_config {
+    double start;               ///< First frequency, in Hz
+    double stop;                ///< Last frequency, in Hz
+    unsigned points;            ///< Number of points, 1 to SWEEP_POINTS_MAX
+    enum sweep_spacing spacing;
+    unsigned dwell;             ///< Fewest samples per point
+    double dwell_cycles;        ///< Fewest stimulus periods per point, or 0
+    enum sweep_measure measure;
+};
+
+/**
+ * Result at one point. Points whose acquisition failed hold NAN.
+ */
+struct sweep_result {
+    float freq;         ///< Frequency actually produced, in Hz
+    float magnitude;    ///< Amplitude in ADC counts, or gain
+    float phase;        ///< Phase in degrees, or NAN for SWEEP_TONE
+};
+
+/**
+ * Change the sweep settings. The plan is rebuilt at the next sweep_run.
+ * \param cfg       New settings
+ * \return  false, leaving the settings unchanged, if they are out of range
+ */
+bool sweep_configure(const struct sweep_config *cfg);
+
+/**
+ * Get the sweep settings.
+ */
+void sweep_get_config(struct sweep_config *cfg);
+
+/**
+ * Run the sweep: for each point, retune DDS channel 0, wait for settling if
+ * it is enabled with acq_set_settling, then measure. The plan of tuning
+ * words and sample counts is computed before the first point, and only
+ * again after the settings or the sample rate change, so each point costs
+ * one register write and the acquisition itself.
+ * \return  false if no sample rate is set, it is too fast for SWEEP_DUAL,
+ *          or any point failed
+ */
+bool sweep_run(void);
+
+/**
+ * Get the results of the last sweep.
+ * \param count     Number of points measured
+ * \param measure   Measurement the sweep took, or NULL
+ * \return  Results, valid until the next sweep_run
+ */
+const struct sweep_result *sweep_get_results(unsigned *count,
+        enum sweep_measure *measure);
+
+/**
+ * Number of points of the last sweep whose acquisition failed.
+ */
+unsigned sweep_get_failures(void);
+
+#endif // _WCP52_SWEEP_H
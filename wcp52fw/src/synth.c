@@ -6,17 +6,23 @@
 // Atmel ASF includes
 #include <delay.h>
 #include <pio.h>
+#include <pmc.h>
 #include <spi.h>
+#include <sysclk.h>
 
 #include "conf_board.h"
+#include "conf_spi_master.h"
+#include <math.h>
 #include <string.h>
 
 #include "synth.h"
 
-// Synthesizer registers
+// Synthesizer registers. These shadow the device: each holds the value most
+// recently requested, and is sent only when that value changes.
 uint8_t G_FR1[FR1_LEN];
 uint8_t G_FR2[FR2_LEN];
-uint8_t G_CFR[CFR_LEN];
+uint8_t G_CFR0[CFR_LEN];
+uint8_t G_CFR1[CFR_LEN];
 uint8_t G_CFTW0[CFTW_LEN];
 uint8_t G_CFTW1[CFTW_LEN];
 
@@ -27,6 +33,145 @@ uint8_t G_CPOW1[CPOW_LEN];
 uint8_t G_CACR0[CACR_LEN];
 uint8_t G_CACR1[CACR_LEN];
 
+uint8_t G_LSRR0[LSRR_LEN];
+uint8_t G_LSRR1[LSRR_LEN];
+uint8_t G_RDW0[RDW_LEN];
+uint8_t G_RDW1[RDW_LEN];
+uint8_t G_FDW0[FDW_LEN];
+uint8_t G_FDW1[FDW_LEN];
+uint8_t G_CW10[CW1_LEN];
+uint8_t G_CW11[CW1_LEN];
+
+/**
+ * Shadowed register indices. Channel registers come in pairs, channel 0
+ * first, so REG_xxx0 + channel selects the right one.
+ */
+enum shadow_reg_id {
+    REG_FR1,
+    REG_FR2,
+    REG_CFR0,
+    REG_CFR1,
+    REG_CFTW0,
+    REG_CFTW1,
+    REG_CPOW0,
+    REG_CPOW1,
+    REG_CACR0,
+    REG_CACR1,
+    REG_LSRR0,
+    REG_LSRR1,
+    REG_RDW0,
+    REG_RDW1,
+    REG_FDW0,
+    REG_FDW1,
+    REG_CW10,
+    REG_CW11,
+    REG_COUNT
+};
+
+/**
+ * Description of a shadowed register.
+ */
+struct shadow_reg {
+    uint8_t addr;   ///< Register address
+    uint8_t len;    ///< Length in bytes
+    int8_t channel; ///< Channel number, or -1 for a control register
+    uint8_t *data;  ///< Shadow copy
+    const char *name;   ///< Register name for dumps
+};
+
+static const struct shadow_reg G_REGS[REG_COUNT] = {
+    [REG_FR1]   = {FR1_ADDR,  FR1_LEN,  -1, G_FR1,   "FR1"},
+    [REG_FR2]   = {FR2_ADDR,  FR2_LEN,  -1, G_FR2,   "FR2"},
+    [REG_CFR0]  = {CFR_ADDR,  CFR_LEN,   0, G_CFR0,  "CFR0"},
+    [REG_CFR1]  = {CFR_ADDR,  CFR_LEN,   1, G_CFR1,  "CFR1"},
+    [REG_CFTW0] = {CFTW_ADDR, CFTW_LEN,  0, G_CFTW0, "CFTW0"},
+    [REG_CFTW1] = {CFTW_ADDR, CFTW_LEN,  1, G_CFTW1, "CFTW1"},
+    [REG_CPOW0] = {CPOW_ADDR, CPOW_LEN,  0, G_CPOW0, "CPOW0"},
+    [REG_CPOW1] = {CPOW_ADDR, CPOW_LEN,  1, G_CPOW1, "CPOW1"},
+    [REG_CACR0] = {CACR_ADDR, CACR_LEN,  0, G_CACR0, "CACR0"},
+    [REG_CACR1] = {CACR_ADDR, CACR_LEN,  1, G_CACR1, "CACR1"},
+    [REG_LSRR0] = {LSRR_ADDR, LSRR_LEN,  0, G_LSRR0, "LSRR0"},
+    [REG_LSRR1] = {LSRR_ADDR, LSRR_LEN,  1, G_LSRR1, "LSRR1"},
+    [REG_RDW0]  = {RDW_ADDR,  RDW_LEN,   0, G_RDW0,  "RDW0"},
+    [REG_RDW1]  = {RDW_ADDR,  RDW_LEN,   1, G_RDW1,  "RDW1"},
+    [REG_FDW0]  = {FDW_ADDR,  FDW_LEN,   0, G_FDW0,  "FDW0"},
+    [REG_FDW1]  = {FDW_ADDR,  FDW_LEN,   1, G_FDW1,  "FDW1"},
+    [REG_CW10]  = {CW1_ADDR,  CW1_LEN,   0, G_CW10,  "CW10"},
+    [REG_CW11]  = {CW1_ADDR,  CW1_LEN,   1, G_CW11,  "CW11"},
+};
+
+// Bit per shadow_reg_id: shadow known to match the device
+static uint32_t G_REG_VALID = 0;
+
+// Bit per shadow_reg_id: shadow changed but not yet sent
+static volatile uint32_t G_REG_DIRTY = 0;
+
+// CSR_BOTH as a channel number: both channels enabled
+#define CSR_BOTH 2
+
+// CSR contents enabling each channel, or both, in 3-wire serial mode
+static const uint8_t G_CSR_VALUES[] = {
+    [0] = 0x82, [1] = 0x42, [CSR_BOTH] = 0xc2,
+};
+
+// CSR contents with no channel enabled
+#define CSR_NONE 0x02
+
+// Instruction byte flag for a register read
+#define READ_BIT 0x80
+
+// Channel currently enabled in the CSR, CSR_BOTH, or -1 if unknown
+static int8_t G_CSR_CHANNEL = -1;
+
+// Read registers back after every commit
+static bool G_VERIFY = false;
+
+// Bit per shadow_reg_id: sent by the last flush, not yet verified
+static uint32_t G_REG_SENT = 0;
+
+// Number of times verification failed and the interface was resynced
+static uint32_t G_RESYNC_COUNT = 0;
+
+// Nesting depth of synth_begin; registers are only sent at depth 0
+static volatile unsigned G_TXN_DEPTH = 0;
+
+// Nonzero while the main path is using the shadows or the SPI port. The
+// ramp timer interrupt leaves the driver alone until it clears.
+static volatile unsigned G_DRIVER_BUSY = 0;
+
+/**
+ * Longest possible transaction: every register, plus a channel select
+ * before each channel's group.
+ */
+#define SPI_BUF_LEN 96
+
+// Transfer buffers; one can be filled while the PDC sends the other
+static uint8_t G_SPI_BUF[2][SPI_BUF_LEN];
+static unsigned G_SPI_BUF_IDX = 0;
+
+// Set while a PDC transfer is in flight
+static volatile bool G_SPI_BUSY = false;
+
+// Software amplitude ramp stepped by the ramp timer interrupt: its channel,
+// or -1 if none, the scale factor last written, the final one, the size of
+// each step and the number of steps still to take
+static volatile int8_t G_RAMP_CHANNEL = -1;
+static volatile uint16_t G_RAMP_ASF;
+static volatile uint16_t G_RAMP_TARGET;
+static volatile uint16_t G_RAMP_STEP;
+static volatile unsigned G_RAMP_LEFT;
+
+/**
+ * Stop the ramp timer, abandoning any ramp in progress where it is.
+ */
+static void ramp_stop(void)
+{
+    TcChannel *tc = &SYNTH_RAMP_TC->TC_CHANNEL[SYNTH_RAMP_TC_CHANNEL];
+
+    tc->TC_IDR = TC_IDR_CPCS;
+    tc->TC_CCR = TC_CCR_CLKDIS;
+    G_RAMP_CHANNEL = -1;
+}
 
 /**
  * Reset the DDS IO system. This aborts a current IO cycle and prepares for
@@ -56,54 +201,355 @@ static void spi_wait(void)
 }
 
 /**
- *  Send a control register to the DDS device.
- *  \param addr     Register address
- *  \param data     Register data array
- *  \param data_length  Length of data array
+ * Start a DDS write transaction by selecting the chip.
+ */
+static void spi_begin(void)
+{
+    pio_set_pin_low(GPIO_DDS_nCS);
+    syncio();
+}
+
+/**
+ * Append one register write to a transfer buffer.
+ * \param buf      Buffer to append to
+ * \param addr     Register address
+ * \param data     Register data array
+ * \param data_length  Length of data array
+ * \return  Pointer just past the appended bytes
  */
-static void send_control_register(
+static uint8_t *spi_append_register(uint8_t *buf,
         uint8_t addr, const uint8_t *data, size_t data_length)
 {
+    *buf++ = addr;
+    memcpy(buf, data, data_length);
+    return buf + data_length;
+}
+
+/**
+ * Start sending a transfer buffer through the SPI PDC. The chip is selected
+ * now; SPI_Handler deselects it and raises IO_UPDATE when the last byte is
+ * out.
+ * \param buf      Bytes to send, must stay valid until completion
+ * \param len      Number of bytes
+ */
+static void spi_start_transfer(const uint8_t *buf, size_t len)
+{
+    Pdc *pdc = spi_get_pdc_base(SPI_MASTER_BASE);
+
+    G_SPI_BUSY = true;
+
+    spi_begin();
+    pdc->PERIPH_TPR = (uint32_t) buf;
+    pdc->PERIPH_TCR = len;
+    pdc->PERIPH_PTCR = PERIPH_PTCR_TXTEN;
+    spi_enable_interrupt(SPI_MASTER_BASE, SPI_IER_ENDTX);
+}
+
+/**
+ * SPI interrupt handler. Finishes PDC transfers started by
+ * spi_start_transfer.
+ */
+void SPI_Handler(void)
+{
+    uint32_t status = spi_read_status(SPI_MASTER_BASE);
+    uint32_t mask = spi_read_interrupt_mask(SPI_MASTER_BASE);
+
+    if ((mask & SPI_IMR_ENDTX) && (status & SPI_SR_ENDTX)) {
+        // The PDC has handed over the last byte; wait for it to shift out
+        spi_disable_interrupt(SPI_MASTER_BASE, SPI_IDR_ENDTX);
+        spi_enable_interrupt(SPI_MASTER_BASE, SPI_IER_TXEMPTY);
+    }
+
+    if ((mask & SPI_IMR_TXEMPTY) && (status & SPI_SR_TXEMPTY)) {
+        spi_disable_interrupt(SPI_MASTER_BASE, SPI_IDR_TXEMPTY);
+        spi_get_pdc_base(SPI_MASTER_BASE)->PERIPH_PTCR = PERIPH_PTCR_TXTDIS;
+        pio_set_pin_high(GPIO_DDS_nCS);
+        io_update();
+
+        G_SPI_BUSY = false;
+    }
+}
+
+/**
+ * Wait for the PDC transfer in flight, if any, to complete.
+ */
+static void transfer_wait(void)
+{
+    while (G_SPI_BUSY);
+}
+
+/**
+ * Request a register value. Nothing is sent if the device already holds it.
+ * \param reg   Shadowed register
+ * \param data  New register contents
+ */
+static void reg_write(enum shadow_reg_id reg, const uint8_t *data)
+{
+    const struct shadow_reg *r = &G_REGS[reg];
+    uint32_t bit = 1uL << reg;
+
+    if ((G_REG_VALID & bit) && !memcmp(r->data, data, r->len)) {
+        return;
+    }
+
+    ++G_DRIVER_BUSY;
+    memcpy(r->data, data, r->len);
+    G_REG_VALID |= bit;
+    G_REG_DIRTY |= bit;
+    --G_DRIVER_BUSY;
+}
+
+/**
+ * Append a shadowed register to a transfer buffer, preceded by a channel
+ * select if the CSR does not already enable the right channels. The CSR
+ * takes effect without IO_UPDATE.
+ * \param buf      Buffer to append to
+ * \param r        Register to send
+ * \param csr      Channel to enable: 0, 1, CSR_BOTH, or -1 for a control
+ *                 register
+ * \return  Pointer just past the appended bytes
+ */
+static uint8_t *append_shadow_register(uint8_t *buf,
+        const struct shadow_reg *r, int csr)
+{
+    if (csr >= 0 && csr != G_CSR_CHANNEL) {
+        buf = spi_append_register(buf, CSR_ADDR, &G_CSR_VALUES[csr], CSR_LEN);
+        G_CSR_CHANNEL = csr;
+    }
+    return spi_append_register(buf, r->addr, r->data, r->len);
+}
+
+/**
+ * Send every register changed since the last flush, all within one chip
+ * select and committed by a single IO_UPDATE. The transfer runs in the
+ * background. Does nothing while a transaction is open.
+ */
+static void reg_flush(void)
+{
+    if (G_TXN_DEPTH || !G_REG_DIRTY) {
+        return;
+    }
+
+    ++G_DRIVER_BUSY;
+    uint8_t *buf = G_SPI_BUF[G_SPI_BUF_IDX];
+    uint8_t *p = buf;
+    G_SPI_BUF_IDX ^= 1;
+
+    uint32_t dirty = G_REG_DIRTY;
+    G_REG_SENT |= dirty;
+
+    // Control registers first
+    for (unsigned reg = 0; reg < REG_COUNT; ++reg) {
+        if ((dirty & (1uL << reg)) && G_REGS[reg].channel < 0) {
+            p = append_shadow_register(p, &G_REGS[reg], -1);
+        }
+    }
+
+    // A register changing to the same value on both channels is written
+    // once with both channels enabled
+    for (unsigned reg = 0; reg < REG_COUNT; ++reg) {
+        const struct shadow_reg *r = &G_REGS[reg];
+        uint32_t pair = 3uL << reg;
+        if (r->channel != 0 || (dirty & pair) != pair
+                || memcmp(r->data, G_REGS[reg + 1].data, r->len)) {
+            continue;
+        }
+        p = append_shadow_register(p, r, CSR_BOTH);
+        dirty &= ~pair;
+    }
+
+    // Then each channel's remaining registers together, so the CSR changes
+    // at most twice
+    for (int channel = 0; channel <= 1; ++channel) {
+        for (unsigned reg = 0; reg < REG_COUNT; ++reg) {
+            if ((dirty & (1uL << reg)) && G_REGS[reg].channel == channel) {
+                p = append_shadow_register(p, &G_REGS[reg], channel);
+            }
+        }
+    }
+    G_REG_DIRTY = 0;
+
+    // The previous transfer must be finished before the chip is selected
+    // again
+    transfer_wait();
+    spi_start_transfer(buf, p - buf);
+    --G_DRIVER_BUSY;
+}
+
+void synth_begin(void)
+{
+    ++G_TXN_DEPTH;
+}
+
+/**
+ * Exchange one byte on the SPI bus, waiting for it to complete.
+ */
+static uint8_t spi_transfer_byte(uint8_t out)
+{
+    uint16_t in = 0;
+    uint8_t pcs;
+
+    spi_write(SPI_MASTER_BASE, out, 0, 0);
+    spi_read(SPI_MASTER_BASE, &in, &pcs);
+    return in;
+}
+
+/**
+ * Read a register from the device. The DDS returns data on SDIO_2, wired to
+ * MISO, in 3-wire mode.
+ * \param addr     Register address
+ * \param csr      Channel to enable first: 0, 1, or -1 for a control
+ *                 register
+ * \param data     Buffer for the contents
+ * \param data_length  Length of the register
+ */
+static void reg_read(uint8_t addr, int csr, uint8_t *data, size_t data_length)
+{
+    ++G_DRIVER_BUSY;
+    transfer_wait();
+
+    // Drop whatever the last transmit-only transfer left behind
+    (void) SPI_MASTER_BASE->SPI_RDR;
+
     pio_set_pin_low(GPIO_DDS_nCS);
     syncio();
-    spi_write(SPI_MASTER_BASE, addr, 0, 0);
+    if (csr >= 0 && csr != G_CSR_CHANNEL) {
+        spi_transfer_byte(CSR_ADDR);
+        spi_transfer_byte(G_CSR_VALUES[csr]);
+        G_CSR_CHANNEL = csr;
+    }
+    spi_transfer_byte(addr | READ_BIT);
     for (size_t i = 0; i < data_length; ++i) {
-        spi_write(SPI_MASTER_BASE, data[i], 0, 0);
+        data[i] = spi_transfer_byte(0);
     }
-    spi_wait();
     pio_set_pin_high(GPIO_DDS_nCS);
-    io_update();
+    --G_DRIVER_BUSY;
+}
+
+/**
+ * Check shadowed registers against the device.
+ * \param mask     Bit per shadow_reg_id to check
+ * \return  true if all match
+ */
+static bool reg_verify(uint32_t mask)
+{
+    uint8_t data[4];
+
+    for (unsigned reg = 0; reg < REG_COUNT; ++reg) {
+        if (!(mask & (1uL << reg))) {
+            continue;
+        }
+
+        const struct shadow_reg *r = &G_REGS[reg];
+        reg_read(r->addr, r->channel, data, r->len);
+        if (memcmp(data, r->data, r->len)) {
+            return false;
+        }
+    }
+    return true;
 }
 
 /**
- * Send a channel register to the DDS device.
- * @param addr  Register address
- * @param data  Register data array
- * @param data_len      Length of data array
- * @param channel_num   Channel number (0 or 1)
+ * If verification is on, read back what the last flushes sent and resync
+ * on a mismatch.
  */
-static void send_channel_register(
-        uint8_t addr, const uint8_t *data,
-        size_t data_length, unsigned channel_num)
+static void verify_sent(void)
 {
-    if (channel_num > 1) return;
+    uint32_t sent = G_REG_SENT;
+    G_REG_SENT = 0;
+
+    if (!G_VERIFY || !sent || G_TXN_DEPTH) {
+        return;
+    }
 
+    if (!reg_verify(sent)) {
+        ++G_RESYNC_COUNT;
+        synth_resync();
+    }
+}
+
+/**
+ * Send any changed registers and wait for them to take effect. Inside a
+ * transaction this only waits for a transfer already in flight.
+ */
+static void reg_commit(void)
+{
+    reg_flush();
+    transfer_wait();
+    verify_sent();
+}
+
+void synth_commit(void)
+{
+    if (G_TXN_DEPTH) {
+        --G_TXN_DEPTH;
+    }
+    reg_commit();
+}
+
+bool synth_resync(void)
+{
+    ++G_DRIVER_BUSY;
+    transfer_wait();
+
+    // Abort whatever the serial port thinks it is in the middle of, and
+    // restore the serial mode
     pio_set_pin_low(GPIO_DDS_nCS);
     syncio();
+    spi_transfer_byte(CSR_ADDR);
+    spi_transfer_byte(CSR_NONE);
+    pio_set_pin_high(GPIO_DDS_nCS);
+    G_CSR_CHANNEL = -1;
 
-    // First, set the proper 'channel enable' bit
-    spi_write(SPI_MASTER_BASE, 0x00, 0, 0);
-    spi_write(SPI_MASTER_BASE, channel_num ? 0x42 : 0x82, 0, 0);
+    // Send the whole known register file again
+    uint32_t known = G_REG_VALID;
+    G_REG_DIRTY = known;
+    reg_flush();
+    transfer_wait();
+    G_REG_SENT = 0;
 
-    // Now, send the data
-    spi_write(SPI_MASTER_BASE, addr, 0, 0);
-    for (size_t i = 0; i < data_length; ++i) {
-        spi_write(SPI_MASTER_BASE, data[i], 0, 0);
+    bool ok = reg_verify(known);
+    --G_DRIVER_BUSY;
+    return ok;
+}
+
+void synth_set_verify(bool verify)
+{
+    G_VERIFY = verify;
+}
+
+uint32_t synth_get_resync_count(void)
+{
+    return G_RESYNC_COUNT;
+}
+
+void synth_dump(bool (*regfxn) (const char *name, const uint8_t *data, size_t len))
+{
+    uint8_t data[4];
+
+    reg_read(CSR_ADDR, -1, data, CSR_LEN);
+    if (!regfxn("CSR", data, CSR_LEN)) return;
+
+    for (unsigned reg = 0; reg < REG_COUNT; ++reg) {
+        const struct shadow_reg *r = &G_REGS[reg];
+        reg_read(r->addr, r->channel, data, r->len);
+        if (!regfxn(r->name, data, r->len)) return;
     }
+}
 
-    spi_wait();
-    pio_set_pin_high(GPIO_DDS_nCS);
-    io_update();
+uint32_t synth_set_spi_clock(uint32_t hz)
+{
+    uint32_t mck = sysclk_get_peripheral_hz();
+    uint32_t div = (mck + hz - 1) / hz;
+
+    if (div < 1) div = 1;
+    if (div > 255) div = 255;
+
+    ++G_DRIVER_BUSY;
+    transfer_wait();
+    spi_set_baudrate_div(SPI_MASTER_BASE, SPI_CHIP_SEL, div);
+    --G_DRIVER_BUSY;
+    return mck / div;
 }
 
 /**
@@ -111,6 +557,10 @@ static void send_channel_register(
  */
 void synth_initialize_interface(void)
 {
+    // The reset below loses any ramp's progress
+    ramp_stop();
+    ++G_DRIVER_BUSY;
+
     // Ensure sane pin defaults
 	pio_set_pin_low(GPIO_DDS_PWRDN);
 	pio_set_pin_low(GPIO_DDS_nCS);
@@ -120,10 +570,22 @@ void synth_initialize_interface(void)
     // No idea how long! I can't find it in the datasheet...
     delay_ms(50);
 
+    // Let any transfer in flight finish, then take over the SPI directly
+    transfer_wait();
+
     // Perform a master reset
 	pio_set_pin_high(GPIO_DDS_MRST);
 	pio_set_pin_low(GPIO_DDS_MRST);
 
+    // The registers are back at their defaults, not what we last sent.
+    // CFR is read-modify-written, so its default must be known.
+    static const uint8_t cfr_default[CFR_LEN] = {0x00, 0x03, 0x02};
+    memcpy(G_CFR0, cfr_default, CFR_LEN);
+    memcpy(G_CFR1, cfr_default, CFR_LEN);
+    G_REG_VALID = (1uL << REG_CFR0) | (1uL << REG_CFR1);
+    G_REG_DIRTY = 0;
+    G_CSR_CHANNEL = -1;
+
     // Configure standard SPI mode
     syncio();
 	spi_write(SPI_MASTER_BASE, 0x00, 0, 0);
@@ -132,6 +594,7 @@ void synth_initialize_interface(void)
     spi_wait();
     pio_set_pin_high(GPIO_DDS_nCS);
     io_update();
+    --G_DRIVER_BUSY;
 }
 
 /**
@@ -139,15 +602,369 @@ void synth_initialize_interface(void)
  */
 void synth_initialize_clock(void)
 {
-    memset(G_FR1, 0, FR1_LEN);
-    REGSET(G_FR1, FR1_VCOGAIN, 1); /* VCO gain set for high frequency */
-    REGSET(G_FR1, FR1_PLLRATIO, 20); /* PLL: 25 MHz crystal * 20 = 500 MHz */
+    uint8_t fr1[FR1_LEN] = {0};
+    REGSET(fr1, FR1_VCOGAIN, 1); /* VCO gain set for high frequency */
+    REGSET(fr1, FR1_PLLRATIO, 20); /* PLL: 25 MHz crystal * 20 = 500 MHz */
+    reg_write(REG_FR1, fr1);
+
+    uint8_t fr2[FR2_LEN] = {0};
+    REGSET(fr2, FR2_ALL_AUTOCLEAR_PHASE, 1); /* Autoclear phase accumulator on IOup*/
+    reg_write(REG_FR2, fr2);
+
+    reg_commit();
+}
+
+uint32_t synth_freq_to_ftw(uint64_t freq_mhz)
+{
+    // FTW = 2^32 * Fout / Fsys, rounded to nearest. 2^32 * Fout does not fit
+    // in 64 bits, so divide in two 16-bit steps, carrying the remainder.
+    const uint64_t d = (uint64_t) SYSCLK_FREQ * 1000u;
+    uint64_t q1 = (freq_mhz << 16) / d;
+    uint64_t r1 = (freq_mhz << 16) % d;
+    uint64_t q2 = ((r1 << 16) + d / 2) / d;
+
+    return (uint32_t) ((q1 << 16) + q2);
+}
+
+uint16_t synth_phase_to_pow(int32_t phase_mdeg)
+{
+    // POW = 2^14 * phase / 360, rounded to nearest, modulo one turn
+    int32_t turn = phase_mdeg % 360000;
+    if (turn < 0) {
+        turn += 360000;
+    }
+    uint32_t pow = ((uint64_t) turn * 16384u + 180000u) / 360000u;
+    return pow & 0x3fff;
+}
+
+uint16_t synth_amplitude_to_asf(uint32_t amplitude_ppm)
+{
+    // ASF = 1023 * amplitude, rounded to nearest
+    if (amplitude_ppm > 1000000u) {
+        amplitude_ppm = 1000000u;
+    }
+    return (amplitude_ppm * 1023u + 500000u) / 1000000u;
+}
 
-    send_control_register(FR1_ADDR, G_FR1, FR1_LEN);
+void synth_plan_point(struct synth_point *pt,
+        uint64_t freq_mhz, int32_t phase_mdeg, uint32_t amplitude_ppm)
+{
+    pt->ftw = synth_freq_to_ftw(freq_mhz);
+    pt->pow = synth_phase_to_pow(phase_mdeg);
+    pt->asf = synth_amplitude_to_asf(amplitude_ppm);
+}
 
-    memset(G_FR2, 0, FR2_LEN);
-    REGSET(G_FR2, FR2_ALL_AUTOCLEAR_PHASE, 1); /* Autoclear phase accumulator on IOup*/
-    send_control_register(FR2_ADDR, G_FR2, FR2_LEN);
+/**
+ * Queue a new frequency tuning word for a channel.
+ */
+static void queue_ftw(unsigned channel, uint32_t ftw)
+{
+    uint8_t cftw[CFTW_LEN];
+    cftw[0] = (ftw & 0xff000000uL) >> 24;
+    cftw[1] = (ftw & 0x00ff0000uL) >> 16;
+    cftw[2] = (ftw & 0x0000ff00uL) >> 8;
+    cftw[3] = (ftw & 0x000000ffuL);
+    reg_write(REG_CFTW0 + channel, cftw);
+}
+
+/**
+ * Queue a new phase offset word for a channel.
+ */
+static void queue_pow(unsigned channel, uint16_t pow)
+{
+    uint8_t cpow[CPOW_LEN];
+    cpow[0] = (pow & 0x3f00u) >> 8;
+    cpow[1] = (pow & 0x00ffu);
+    reg_write(REG_CPOW0 + channel, cpow);
+}
+
+/**
+ * Queue an amplitude scale factor for a channel, with the amplitude
+ * multiplier enabled. The ramp rate stays zero: the ACR amplitude ramp is
+ * only driven by the profile pins, which are not routed on this board.
+ */
+static void write_asf(unsigned channel, uint16_t asf)
+{
+    uint8_t cacr[CACR_LEN] = {0};
+    cacr[1] = (asf & 0x0300u) >> 8;
+    cacr[2] = (asf & 0x00ffu);
+    REGSET(cacr, CACR_MULT_ENABLE, 1);
+    reg_write(REG_CACR0 + channel, cacr);
+}
+
+/**
+ * Queue a new amplitude scale factor for a channel, stopping any ramp on
+ * that channel.
+ */
+static void queue_asf(unsigned channel, uint16_t asf)
+{
+    if (G_RAMP_CHANNEL == (int) channel) {
+        ramp_stop();
+    }
+    write_asf(channel, asf);
+}
+
+/**
+ * Queue a 32-bit word into a four-byte register, most significant first.
+ */
+static void queue_word(enum shadow_reg_id reg, uint32_t word)
+{
+    uint8_t data[4];
+    data[0] = (word & 0xff000000uL) >> 24;
+    data[1] = (word & 0x00ff0000uL) >> 16;
+    data[2] = (word & 0x0000ff00uL) >> 8;
+    data[3] = (word & 0x000000ffuL);
+    reg_write(reg, data);
+}
+
+/**
+ * Left shift that aligns a sweep parameter's word to the top of the 32-bit
+ * delta and chain word registers.
+ */
+static unsigned sweep_shift(enum synth_sweep_param param)
+{
+    switch (param) {
+    case SYNTH_SWEEP_PHASE:
+        return 32 - 14;
+    case SYNTH_SWEEP_AMPLITUDE:
+        return 32 - 10;
+    default:
+        return 0;
+    }
+}
+
+void synth_sweep_plan(struct synth_sweep *sw, double seconds)
+{
+    unsigned shift = sweep_shift(sw->param);
+    double span = (double) ((sw->stop - sw->start) << shift);
+    double ticks = seconds * SYNC_CLK_FREQ;
+    unsigned rate;
+    double delta = 0.0;
+
+    // Step as often as possible, every SYNC_CLK period, for the most and
+    // finest steps; only step less often while the step would be less than
+    // one LSB
+    for (rate = 1; rate < 255; ++rate) {
+        delta = span * rate / ticks;
+        if (delta >= (double) (1uL << shift)) {
+            break;
+        }
+    }
+
+    uint32_t delta32;
+    if (delta < (double) (1uL << shift)) {
+        delta32 = 1uL << shift;
+    } else if (delta > 4294967295.) {
+        delta32 = 0xffffffffuL;
+    } else {
+        delta32 = (uint32_t) (delta + 0.5);
+    }
+
+    sw->rise_delta = sw->fall_delta = delta32;
+    sw->rise_rate = sw->fall_rate = rate;
+}
+
+void synth_sweep_configure(unsigned channel, const struct synth_sweep *sw)
+{
+    static const uint8_t afp[] = {
+        [SYNTH_SWEEP_FREQUENCY] = CFR_AFP_FREQUENCY,
+        [SYNTH_SWEEP_PHASE] = CFR_AFP_PHASE,
+        [SYNTH_SWEEP_AMPLITUDE] = CFR_AFP_AMPLITUDE,
+    };
+
+    if (channel > 1) return;
+
+    synth_begin();
+
+    switch (sw->param) {
+    case SYNTH_SWEEP_FREQUENCY:
+        queue_ftw(channel, sw->start);
+        break;
+    case SYNTH_SWEEP_PHASE:
+        queue_pow(channel, sw->start);
+        break;
+    case SYNTH_SWEEP_AMPLITUDE:
+        queue_asf(channel, sw->start);
+        break;
+    }
+
+    unsigned shift = sweep_shift(sw->param);
+    queue_word(REG_CW10 + channel, sw->stop << shift);
+    queue_word(REG_RDW0 + channel, sw->rise_delta);
+    queue_word(REG_FDW0 + channel, sw->fall_delta);
+
+    uint8_t lsrr[LSRR_LEN] = {sw->fall_rate, sw->rise_rate};
+    reg_write(REG_LSRR0 + channel, lsrr);
+
+    uint8_t cfr[CFR_LEN];
+    memcpy(cfr, G_REGS[REG_CFR0 + channel].data, CFR_LEN);
+    cfr[CFR_AFP_SELECT_I] &= ~(3u << CFR_AFP_SELECT_B);
+    cfr[CFR_SWEEP_NODWELL_I] &= ~(1u << CFR_SWEEP_NODWELL_B);
+    REGSET(cfr, CFR_AFP_SELECT, afp[sw->param]);
+    REGSET(cfr, CFR_SWEEP_ENABLE, 1);
+    if (sw->no_dwell) {
+        REGSET(cfr, CFR_SWEEP_NODWELL, 1);
+    }
+    reg_write(REG_CFR0 + channel, cfr);
+
+    synth_commit();
+}
+
+void synth_sweep_disable(unsigned channel)
+{
+    if (channel > 1) return;
+
+    uint8_t cfr[CFR_LEN];
+    memcpy(cfr, G_REGS[REG_CFR0 + channel].data, CFR_LEN);
+    cfr[CFR_AFP_SELECT_I] &= ~(3u << CFR_AFP_SELECT_B);
+    cfr[CFR_SWEEP_ENABLE_I] &= ~(1u << CFR_SWEEP_ENABLE_B);
+    cfr[CFR_SWEEP_NODWELL_I] &= ~(1u << CFR_SWEEP_NODWELL_B);
+    reg_write(REG_CFR0 + channel, cfr);
+    reg_commit();
+}
+
+void synth_get_point(unsigned channel, struct synth_point *pt)
+{
+    if (channel > 1) return;
+
+    const uint8_t *cftw = G_REGS[REG_CFTW0 + channel].data;
+    const uint8_t *cpow = G_REGS[REG_CPOW0 + channel].data;
+    const uint8_t *cacr = G_REGS[REG_CACR0 + channel].data;
+
+    ++G_DRIVER_BUSY;
+    pt->ftw = ((uint32_t) cftw[0] << 24) | ((uint32_t) cftw[1] << 16)
+        | ((uint32_t) cftw[2] << 8) | (uint32_t) cftw[3];
+    pt->pow = (((uint16_t) cpow[0] << 8) | cpow[1]) & 0x3fff;
+    pt->asf = (((uint16_t) cacr[1] << 8) | cacr[2]) & 0x03ff;
+    --G_DRIVER_BUSY;
+}
+
+void synth_load_both(const struct synth_point *pt0,
+        const struct synth_point *pt1)
+{
+    synth_begin();
+    synth_load_point(0, pt0);
+    synth_load_point(1, pt1);
+    synth_commit();
+}
+
+void synth_set_ftw(unsigned channel, uint32_t ftw)
+{
+    if (channel > 1) return;
+    queue_ftw(channel, ftw);
+    reg_commit();
+}
+
+void synth_set_pow(unsigned channel, uint16_t pow)
+{
+    if (channel > 1) return;
+    queue_pow(channel, pow);
+    reg_commit();
+}
+
+void synth_set_asf(unsigned channel, uint16_t asf)
+{
+    if (channel > 1) return;
+    queue_asf(channel, asf);
+    reg_commit();
+}
+
+void synth_ramp_setup(void)
+{
+    pmc_enable_periph_clk(SYNTH_RAMP_TC_ID);
+    NVIC_EnableIRQ(SYNTH_RAMP_TC_IRQn);
+}
+
+/**
+ * Ramp timer interrupt handler. Writes the next step of the ramp set up by
+ * synth_ramp_asf and sends it without waiting.
+ */
+void SYNTH_RAMP_TC_Handler(void)
+{
+    TcChannel *tc = &SYNTH_RAMP_TC->TC_CHANNEL[SYNTH_RAMP_TC_CHANNEL];
+    int channel = G_RAMP_CHANNEL;
+
+    // Reading the status acknowledges the compare
+    (void) tc->TC_SR;
+
+    // Anything the main path has started must finish first, and a transfer
+    // in flight can't be waited for here
+    if (channel < 0 || G_DRIVER_BUSY || G_TXN_DEPTH || G_REG_DIRTY
+            || G_SPI_BUSY) {
+        return;
+    }
+
+    if (--G_RAMP_LEFT) {
+        G_RAMP_ASF = (G_RAMP_TARGET > G_RAMP_ASF)
+            ? G_RAMP_ASF + G_RAMP_STEP : G_RAMP_ASF - G_RAMP_STEP;
+    } else {
+        G_RAMP_ASF = G_RAMP_TARGET;
+        ramp_stop();
+    }
+
+    write_asf(channel, G_RAMP_ASF);
+    reg_flush();
+}
+
+void synth_ramp_asf(unsigned channel, uint16_t asf, double seconds)
+{
+    TcChannel *tc = &SYNTH_RAMP_TC->TC_CHANNEL[SYNTH_RAMP_TC_CHANNEL];
+    struct synth_point pt;
+    unsigned span, step, steps;
+    double period_us;
+
+    if (channel > 1) return;
+
+    // Finish any ramp still running on the other channel
+    int running = G_RAMP_CHANNEL;
+    ramp_stop();
+    if (running >= 0 && running != (int) channel) {
+        synth_set_asf(running, G_RAMP_TARGET);
+    }
+
+    asf &= 0x03ff;
+    synth_get_point(channel, &pt);
+    span = (asf > pt.asf) ? asf - pt.asf : pt.asf - asf;
+
+    if (seconds > SYNTH_RAMP_MAX_MS / 1e3) {
+        seconds = SYNTH_RAMP_MAX_MS / 1e3;
+    }
+
+    if (span == 0 || !(seconds * 1e6 >= SYNTH_RAMP_MIN_STEP_US)) {
+        synth_set_asf(channel, asf);
+        return;
+    }
+
+    // One-LSB steps unless that would step faster than the SPI write can
+    // keep up with; then take fewer, larger steps over the same time
+    steps = span;
+    if (seconds * 1e6 / steps < SYNTH_RAMP_MIN_STEP_US) {
+        steps = (unsigned) (seconds * 1e6 / SYNTH_RAMP_MIN_STEP_US);
+    }
+    step = (span + steps - 1) / steps;
+    steps = (span + step - 1) / step;
+    period_us = seconds * 1e6 / steps;
+
+    G_RAMP_ASF = pt.asf;
+    G_RAMP_TARGET = asf;
+    G_RAMP_STEP = step;
+    G_RAMP_LEFT = steps;
+
+    // MCK/128 fits a SYNTH_RAMP_MAX_MS period in the 16-bit counter
+    tc->TC_CMR = TC_CMR_TCCLKS_TIMER_CLOCK4 | TC_CMR_WAVE | TC_CMR_WAVSEL_UP_RC;
+    tc->TC_RC = lround(period_us * 1e-6 * sysclk_get_peripheral_hz() / 128);
+    G_RAMP_CHANNEL = channel;
+    tc->TC_IER = TC_IER_CPCS;
+    tc->TC_CCR = TC_CCR_CLKEN | TC_CCR_SWTRG;
+}
+
+void synth_load_point(unsigned channel, const struct synth_point *pt)
+{
+    if (channel > 1) return;
+    queue_ftw(channel, pt->ftw);
+    queue_pow(channel, pt->pow);
+    queue_asf(channel, pt->asf);
+    reg_commit();
 }
 
 /**
@@ -157,68 +974,56 @@ void synth_initialize_clock(void)
  */
 void synth_set_frequency(unsigned channel, double freq)
 {
-    if (channel > 1) return;
-
-    // First, convert 'freq' to a frequency tuning word.
     // From AD9958 datasheet, page 18: Fout = (FTW)(Fsys) / 2^32
-    // So FTW = 2^32 * Fout / Fsys
+    // The conversion itself is exact integer arithmetic on millihertz.
+    if (freq < 0.0) {
+        freq = 0.0;
+    }
+    synth_set_ftw(channel, synth_freq_to_ftw(llround(freq * 1000.)));
+}
 
-    double ftw = (4294967296. * freq) / SYSCLK_FREQ;
-    uint32_t ftw32 = (uint32_t) ftw;
+/**
+ * Get the DDS frequency last set on a channel.
+ * \param channel   Channel number, either 0 or 1
+ * \return  Frequency in Hz actually produced by the tuning word.
+ */
+double synth_get_frequency(unsigned channel)
+{
+    if (channel > 1) return 0.0;
 
-    // Prepare the FTW as an array of four bytes
-    uint8_t *cftw = channel ? G_CFTW1 : G_CFTW0;
-    cftw[0] = (ftw32 & 0xff000000uL) >> 24;
-    cftw[1] = (ftw32 & 0x00ff0000uL) >> 16;
-    cftw[2] = (ftw32 & 0x0000ff00uL) >> 8;
-    cftw[3] = (ftw32 & 0x000000ffuL);
+    const uint8_t *cftw = channel ? G_CFTW1 : G_CFTW0;
+    uint32_t ftw32 = ((uint32_t) cftw[0] << 24)
+        | ((uint32_t) cftw[1] << 16)
+        | ((uint32_t) cftw[2] << 8)
+        | (uint32_t) cftw[3];
 
-    // Transmit the bytes
-    send_channel_register(CFTW_ADDR, cftw, CFTW_LEN, channel);
+    return (ftw32 * (double) SYSCLK_FREQ) / 4294967296.;
 }
 
 
 /**
  * Set the DDS phase on a channel.
  * \param channel   Channel number, either 0 or 1
- * \param freq      Phase in degrees.
+ * \param phase     Phase in degrees.
  */
 void synth_set_phase(unsigned channel, double phase)
 {
-
-  if (channel > 1) return;
-  // convert "phase" to phase offset word
-  // equation according to datasheet page 18 
-  double pow =  (16384. * phase) / 360 ; 
-  uint16_t pow14 = (uint16_t)pow & 0x03FFF;
-
-   //prepare pow as array of 2 bytes 
-    uint8_t *cpow = channel ? G_CPOW1 : G_CPOW0;
-    cpow[0] = (pow14 & 0x0000ff00uL) >> 8;
-    cpow[1] = (pow14 & 0x000000ffuL);
-   
-    send_channel_register(CPOW_ADDR, cpow, CPOW_LEN, channel);
-
+    // Equation according to datasheet page 18, applied in millidegrees
+    synth_set_pow(channel, synth_phase_to_pow(lround(fmod(phase, 360.) * 1000.)));
 }
 
 /**
  * Set the DDS amplitude on a channel.
  * \param channel   Channel number, either 0 or 1
- * \param freq      Amplitude
+ * \param amplitude Amplitude, 0 to 1 of full scale
  */
 void synth_set_amplitude(unsigned channel, double amplitude)
 {
-     if (channel > 1) return;
-     double acr =  1023 * amplitude ; 
-     // 
-     uint16_t acr16 = (uint16_t)acr & 0x03FF;
-     //setting the amplitude enable bit high
-     acr16 |= 0x1000;
-
-    uint8_t *cacr = channel ? G_CACR1 : G_CACR0;
-    cacr[0] = 0; // Ramp rate
-    cacr[1] = (acr16 & 0x0000ff00uL) >> 8;
-    cacr[2] = (acr16 & 0x000000ffuL);
-
-    send_channel_register(CACR_ADDR, cacr, CACR_LEN, channel);
+    if (amplitude < 0.0) {
+        amplitude = 0.0;
+    }
+    if (amplitude > 1.0) {
+        amplitude = 1.0;
+    }
+    synth_set_asf(channel, synth_amplitude_to_asf(lround(amplitude * 1e6)));
 }
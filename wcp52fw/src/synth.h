@@ -6,6 +6,10 @@
 #ifndef _WCP52_SYNTH_H
 #define _WCP52_SYNTH_H 1
 
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stddef.h>
+
 #define SYSCLK_FREQ 500000000uL
 
 /**
@@ -18,12 +22,75 @@ void synth_initialize_interface(void);
  */
 void synth_initialize_clock(void);
 
+/**
+ * Set up the timer that paces synth_ramp_asf.
+ */
+void synth_ramp_setup(void);
+
+/**
+ * Open a DDS transaction. Until the matching synth_commit, the synth_set_*
+ * functions only queue their register changes. Transactions may nest; the
+ * outermost commit sends.
+ */
+void synth_begin(void);
+
+/**
+ * Close a DDS transaction. At the outermost level, every queued register
+ * is streamed in one chip-select window and committed with one IO_UPDATE,
+ * so all changes reach the outputs together.
+ */
+void synth_commit(void);
+
+/**
+ * Read back registers after every commit, and resync the
+ * interface if they do not match.
+ * \param verify    true to enable
+ */
+void synth_set_verify(bool verify);
+
+/**
+ * Number of times verification has found a mismatch and resynced.
+ */
+uint32_t synth_get_resync_count(void);
+
+/**
+ * Recover a desynchronised DDS serial interface: abort the current IO
+ * cycle, restore the serial mode, rewrite every known register and check
+ * it.
+ * \return  true if the device now matches the driver's copy
+ */
+bool synth_resync(void);
+
+/**
+ * Read every register from the device, CSR first, and pass each to a
+ * function. Channel registers are named with their channel number.
+ *
+ * Function prototype:
+ * bool fxn(const char *name, const uint8_t *data, size_t len);
+ *
+ * Return 'true' to continue to the next register, or 'false' to stop.
+ */
+void synth_dump(bool (*regfxn) (const char *name, const uint8_t *data, size_t len));
+
+/**
+ * Set the DDS SPI clock.
+ * \param hz    Highest acceptable clock, in Hz
+ * \return  Clock actually set, in Hz
+ */
+uint32_t synth_set_spi_clock(uint32_t hz);
+
 /**
  * Set the DDS frequency on a channel.
  * \param channel   Channel number, either 0 or 1
  * \param freq      Frequency in Hz.
  */
 void synth_set_frequency(unsigned channel, double freq);
+/**
+ * Get the DDS frequency last set on a channel.
+ * \param channel   Channel number, either 0 or 1
+ * \return  Frequency in Hz actually produced by the tuning word.
+ */
+double synth_get_frequency(unsigned channel);
 /**
  * Set the DDS phase on a channel.
  * \param channel   Channel number, either 0 or 1
@@ -33,9 +100,170 @@ void synth_set_phase(unsigned channel, double phase);
 /**
  * Set the DDS amplitude on a channel.
  * \param channel   Channel number, either 0 or 1
- * \param phase     phase in degrees.
+ * \param amplitude Amplitude, 0 to 1 of full scale
  */
 void synth_set_amplitude(unsigned channel, double amplitude);
+
+/**
+ * Tuning words for one output setting, computed ahead of time so that
+ * loading it costs no arithmetic.
+ */
+struct synth_point {
+    uint32_t ftw;   ///< Frequency tuning word
+    uint16_t pow;   ///< Phase offset word, 14 bits
+    uint16_t asf;   ///< Amplitude scale factor, 10 bits
+};
+
+/**
+ * Convert a frequency to a frequency tuning word, rounded to nearest.
+ * \param freq_mhz  Frequency in millihertz, below SYSCLK_FREQ
+ */
+uint32_t synth_freq_to_ftw(uint64_t freq_mhz);
+
+/**
+ * Convert a phase to a phase offset word, rounded to nearest.
+ * \param phase_mdeg    Phase in millidegrees, any sign or number of turns
+ */
+uint16_t synth_phase_to_pow(int32_t phase_mdeg);
+
+/**
+ * Convert an amplitude to an amplitude scale factor, rounded to nearest.
+ * \param amplitude_ppm Amplitude in millionths of full scale
+ */
+uint16_t synth_amplitude_to_asf(uint32_t amplitude_ppm);
+
+/**
+ * Compute the tuning words for one output setting, e.g. to fill a sweep
+ * table before the sweep starts.
+ * \param pt            Point to fill
+ * \param freq_mhz      Frequency in millihertz
+ * \param phase_mdeg    Phase in millidegrees
+ * \param amplitude_ppm Amplitude in millionths of full scale
+ */
+void synth_plan_point(struct synth_point *pt,
+        uint64_t freq_mhz, int32_t phase_mdeg, uint32_t amplitude_ppm);
+
+/**
+ * Load a precomputed output setting onto a channel. Only the words that
+ * differ from the current ones are sent, in a single transaction.
+ * \param channel   Channel number, either 0 or 1
+ * \param pt        Point to load
+ */
+void synth_load_point(unsigned channel, const struct synth_point *pt);
+
+/**
+ * Quantity swept by the hardware linear sweep.
+ */
+enum synth_sweep_param {
+    SYNTH_SWEEP_FREQUENCY,
+    SYNTH_SWEEP_PHASE,
+    SYNTH_SWEEP_AMPLITUDE,
+};
+
+/**
+ * Hardware linear sweep settings. Words are in the units of the swept
+ * quantity's own register: FTW, 14-bit POW or 10-bit ASF.
+ */
+struct synth_sweep {
+    enum synth_sweep_param param;
+    uint32_t start;         ///< Word at the bottom of the sweep
+    uint32_t stop;          ///< Word at the top of the sweep
+    uint32_t rise_delta;    ///< Step size going up, MSB-aligned to 32 bits
+    uint32_t fall_delta;    ///< Step size going down, MSB-aligned to 32 bits
+    uint8_t rise_rate;      ///< SYNC_CLK periods per step going up
+    uint8_t fall_rate;      ///< SYNC_CLK periods per step going down
+    bool no_dwell;          ///< Return to start at once when the top is reached
+};
+
+/**
+ * Work out sweep steps to cover a range in a given time, in both directions,
+ * using the finest step the ramp rate allows.
+ * \param sw        Sweep to fill; param, start and stop must be set, with
+ *                  start below stop
+ * \param seconds   Time for a full sweep one way
+ */
+void synth_sweep_plan(struct synth_sweep *sw, double seconds);
+
+/**
+ * Program a hardware linear sweep on a channel. The output starts at the
+ * start word; the channel's profile pin then runs the sweep up and back
+ * with no further SPI traffic. This board does not route the profile pins
+ * to the microcontroller, so the firmware cannot trigger the sweep.
+ * \param channel   Channel number, either 0 or 1
+ * \param sw        Sweep settings
+ */
+void synth_sweep_configure(unsigned channel, const struct synth_sweep *sw);
+
+/**
+ * Turn off the hardware sweep on a channel. The output returns to the
+ * start word.
+ * \param channel   Channel number, either 0 or 1
+ */
+void synth_sweep_disable(unsigned channel);
+
+/**
+ * Get the output setting last requested on a channel.
+ * \param channel   Channel number, either 0 or 1
+ * \param pt        Point to fill
+ */
+void synth_get_point(unsigned channel, struct synth_point *pt);
+
+/**
+ * Load output settings onto both channels at the same instant. Everything
+ * goes out in one transaction under a single IO_UPDATE, which also clears
+ * both phase accumulators, so the outputs change together and their phase
+ * offsets are exactly as given. Words equal on both channels are written
+ * once with both channels selected.
+ * \param pt0       Setting for channel 0
+ * \param pt1       Setting for channel 1
+ */
+void synth_load_both(const struct synth_point *pt0,
+        const struct synth_point *pt1);
+
+/**
+ * Ramp a channel's amplitude to a new scale factor in software. The scale
+ * factor is written from the ramp timer interrupt in one-LSB steps spread
+ * over the given time, or in larger steps if one-LSB steps would come
+ * faster than SYNTH_RAMP_MIN_STEP_US. Returns at once.
+ *
+ * Only one ramp runs at a time: one still running on the other channel
+ * jumps to its final amplitude. Setting the channel's amplitude by any
+ * other means stops the ramp where it is. A step that falls due while the
+ * driver is busy, or a transaction is open, is taken on a later tick.
+ * \param channel   Channel number, either 0 or 1
+ * \param asf       Amplitude scale factor, 10 bits
+ * \param seconds   Ramp time, up to SYNTH_RAMP_MAX_MS; shorter than one
+ *                  step period changes in one step
+ */
+void synth_ramp_asf(unsigned channel, uint16_t asf, double seconds);
+
+/**
+ * Set the frequency tuning word on a channel.
+ * \param channel   Channel number, either 0 or 1
+ * \param ftw       Frequency tuning word
+ */
+void synth_set_ftw(unsigned channel, uint32_t ftw);
+
+/**
+ * Set the phase offset word on a channel.
+ * \param channel   Channel number, either 0 or 1
+ * \param pow       Phase offset word, 14 bits
+ */
+void synth_set_pow(unsigned channel, uint16_t pow);
+
+/**
+ * Set the amplitude scale factor on a channel.
+ * \param channel   Channel number, either 0 or 1
+ * \param asf       Amplitude scale factor, 10 bits
+ */
+void synth_set_asf(unsigned channel, uint16_t asf);
+/**
+ * \addtogroup CSR Channel select register
+ * \{ */
+#define CSR_LEN 1
+#define CSR_ADDR 0x00
+/** \} */
+
 /**
  * \addtogroup FR1 Function register 1
  * \{ */
@@ -74,8 +302,53 @@ void synth_set_amplitude(unsigned channel, double amplitude);
 
 #define CACR_LEN 3
 #define CACR_ADDR 0x06
+#define CACR_MULT_ENABLE_I 1
+#define CACR_MULT_ENABLE_B 4
+
+#define LSRR_LEN 2
+#define LSRR_ADDR 0x07
+
+#define RDW_LEN 4
+#define RDW_ADDR 0x08
+
+#define FDW_LEN 4
+#define FDW_ADDR 0x09
+
+#define CW1_LEN 4
+#define CW1_ADDR 0x0a
 /** \} */
 
+/**
+ * \addtogroup CFR Channel function register fields
+ * \{ */
+#define CFR_AFP_SELECT_I 0
+#define CFR_AFP_SELECT_B 6
+#define CFR_AFP_AMPLITUDE 1
+#define CFR_AFP_FREQUENCY 2
+#define CFR_AFP_PHASE 3
+#define CFR_SWEEP_NODWELL_I 1
+#define CFR_SWEEP_NODWELL_B 7
+#define CFR_SWEEP_ENABLE_I 1
+#define CFR_SWEEP_ENABLE_B 6
+/** \} */
+
+/**
+ * SYNC_CLK, the rate at which the sweep ramp steps, in Hz.
+ */
+#define SYNC_CLK_FREQ (SYSCLK_FREQ / 4)
+
+/**
+ * Shortest time between amplitude steps in synth_ramp_asf, in microseconds.
+ * Leaves room for the ACR write and IO_UPDATE of each step.
+ */
+#define SYNTH_RAMP_MIN_STEP_US 20
+
+/**
+ * Longest synth_ramp_asf ramp, in milliseconds. A one-step ramp's period
+ * must fit the ramp timer's 16-bit counter.
+ */
+#define SYNTH_RAMP_MAX_MS 50
+
 /* Register set macro */
 /**
  * Set a value into a register.
@@ -24,6 +24,24 @@ static inline void util_set_pin(uint32_t pin, int_fast8_t value)
     }
 }
 
+/**
+ * Start the core cycle counter, if it is not already running.
+ */
+static inline void util_cycles_enable(void)
+{
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+}
+
+/**
+ * Read the core cycle counter. It wraps every 2^32 core clocks; differences
+ * between two readings are correct across one wrap.
+ */
+static inline uint32_t util_cycles(void)
+{
+    return DWT->CYCCNT;
+}
+
 /**
  * Pin info struct that is passed to a function by for_each_pin
  */
@@ -0,0 +1,108 @@
+/*
+ * File:   test_dsp.c
+ *
+ * Tests for the capture signal processing in dsp.c
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "CUnit/Basic.h"
+
+#include "dsp.h"
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+#define RATE    160000.0
+#define COUNT   1600
+
+/*
+ * CUnit Test Suite
+ */
+
+int init_suite(void) {
+    return 0;
+}
+
+int clean_suite(void) {
+    return 0;
+}
+
+/**
+ * Fill buf with a tone as the ADC would sample it, starting delay seconds
+ * after time zero.
+ */
+static void make_tone(uint16_t *buf, size_t count, double freq,
+        double amplitude, double phase, double delay) {
+    for (size_t i = 0; i < count; ++i) {
+        double t = i / RATE + delay;
+        double x = amplitude * cos(2.0 * M_PI * freq * t + phase * M_PI / 180.0);
+        buf[i] = (uint16_t) lround(DSP_ADC_MIDSCALE + x);
+    }
+}
+
+/**
+ * Measure a DUT tone of known gain and phase against a reference, with the
+ * DUT sampled skew seconds after the reference.
+ */
+static void check_relative(double freq, double true_gain,
+        double true_phase, double skew) {
+    static uint16_t ref[COUNT], dut[COUNT];
+    struct dsp_goertzel g_ref, g_dut;
+    double gain, phase;
+
+    make_tone(ref, COUNT, freq, 1000.0, 0.0, 0.0);
+    make_tone(dut, COUNT, freq, 1000.0 * true_gain, true_phase, skew);
+
+    dsp_goertzel_init(&g_ref, freq, RATE);
+    dsp_goertzel_init(&g_dut, freq, RATE);
+    dsp_goertzel_add(&g_ref, ref, COUNT);
+    dsp_goertzel_add(&g_dut, dut, COUNT);
+    dsp_goertzel_relative(&g_ref, &g_dut, freq, skew, &gain, &phase);
+
+    CU_ASSERT_DOUBLE_EQUAL(gain, true_gain, 0.01);
+    CU_ASSERT_DOUBLE_EQUAL(phase, true_phase, 0.2);
+}
+
+void test_relative() {
+    check_relative(10000.0, 0.5, 30.0, 0.0);
+    check_relative(10000.0, 0.5, -45.0, 0.0);
+}
+
+void test_relative_skew() {
+    // One conversion of 20 ADC clocks at 6.4 MHz, as in dual capture. A
+    // wrong sign on the correction would be off by 22.5 degrees at 10 kHz.
+    check_relative(10000.0, 0.5, 30.0, 3.125e-6);
+    check_relative(10000.0, 2.0, -170.0, 3.125e-6);
+    check_relative(40000.0, 1.0, 90.0, 3.125e-6);
+}
+
+int main() {
+    CU_pSuite pSuite = NULL;
+
+    /* Initialize the CUnit test registry */
+    if (CUE_SUCCESS != CU_initialize_registry())
+        return CU_get_error();
+
+    /* Add a suite to the registry */
+    pSuite = CU_add_suite("DSP", init_suite, clean_suite);
+    if (NULL == pSuite) {
+        CU_cleanup_registry();
+        return CU_get_error();
+    }
+
+    /* Add the tests to the suite */
+    if ((NULL == CU_add_test(pSuite, "relative gain and phase", test_relative))
+            || (NULL == CU_add_test(pSuite, "sampling skew", test_relative_skew))) {
+        CU_cleanup_registry();
+        return CU_get_error();
+    }
+
+    /* Run all tests using the CUnit Basic interface */
+    CU_basic_set_mode(CU_BRM_VERBOSE);
+    CU_basic_run_tests();
+    CU_cleanup_registry();
+    return CU_get_error();
+}